@@ -1,8 +1,15 @@
 #include "Core.h"
 
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 #include <glad/gl.h>
 #include <imgui.h>
@@ -15,6 +22,9 @@
 #include "util/FileUtil.h"
 #include "util/GLFWUtil.h"
 #include "util/GLUtil.h"
+#include "util/Profiler.h"
+#include "util/ResourceCache.h"
+#include "util/ShaderCache.h"
 
 using namespace OGL4Core2::Core;
 
@@ -24,10 +34,38 @@ static constexpr int openGLVersionMajor = 4;
 static constexpr int openGLVersionMinor = 5;
 static constexpr char imguiGlslVersion[] = "#version 450";
 static constexpr char title[] = "OGL4Core2";
+static constexpr std::size_t headlessQueryLatency = 4;
+static constexpr double resourceUploadBudgetMs = 4.0;
 
-Core::Core()
+static void writeTimingsJson(std::ostream& out, const std::string& name, const std::vector<double>& times) {
+    out << "  \"" << name << "\": {\n    \"frames_ms\": [";
+    for (std::size_t i = 0; i < times.size(); i++) {
+        out << (i > 0 ? ", " : "") << times[i];
+    }
+    out << "],\n";
+    const FrameStatistics stats = FpsCounter::computeStatistics(times);
+    // clang-format off
+    out << "    \"min_ms\": " << stats.minMs << ",\n"
+        << "    \"max_ms\": " << stats.maxMs << ",\n"
+        << "    \"mean_ms\": " << stats.meanMs << ",\n"
+        << "    \"p50_ms\": " << stats.p50Ms << ",\n"
+        << "    \"p95_ms\": " << stats.p95Ms << ",\n"
+        << "    \"p99_ms\": " << stats.p99Ms << ",\n"
+        << "    \"stutter_threshold_ms\": " << stats.stutterThresholdMs << ",\n"
+        << "    \"stutters\": " << stats.numStutters << ",\n"
+        << "    \"histogram_bin_width_ms\": " << stats.histogramBinWidthMs << ",\n"
+        << "    \"histogram\": [";
+    // clang-format on
+    for (std::size_t i = 0; i < stats.histogram.size(); i++) {
+        out << (i > 0 ? ", " : "") << stats.histogram[i];
+    }
+    out << "]\n  }";
+}
+
+Core::Core(std::optional<HeadlessOptions> headlessOptions)
     : window_(nullptr),
       running_(false),
+      headless_(std::move(headlessOptions)),
       currentPlugin_(nullptr),
       currentPluginIdx_(-1),
       pluginSelectionIdx_(1),
@@ -39,6 +77,25 @@ Core::Core()
       mouseX_(0.0),
       mouseY_(0.0),
       cameraControlMode_(AbstractCamera::MouseControlMode::None) {
+    // Validate the headless options before creating the context, so nothing has to be cleaned up on errors.
+    if (headless_.has_value()) {
+        if (headless_->width <= 0 || headless_->height <= 0 || headless_->numFrames <= 0 ||
+            headless_->numWarmupFrames < 0) {
+            throw std::runtime_error("Invalid headless options!");
+        }
+        const auto& plugins = PluginRegister::getAll();
+        auto it = std::find_if(plugins.begin(), plugins.end(),
+            [this](const auto& p) { return p->name() == headless_->pluginName; });
+        if (it == plugins.end()) {
+            std::string names;
+            for (const auto& p : plugins) {
+                names += " \"" + p->name() + "\"";
+            }
+            throw std::runtime_error("Plugin \"" + headless_->pluginName + "\" not found! Available:" + names);
+        }
+        pluginSelectionIdx_ = static_cast<int>(std::distance(plugins.begin(), it));
+    }
+
     Core::initGLFW();
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, openGLVersionMajor);
@@ -46,15 +103,25 @@ Core::Core()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
-    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
-
-    window_ = glfwCreateWindow(initWindowSizeWidth, initWindowSizeHeight, title, nullptr, nullptr);
+    if (headless_.has_value()) {
+        // Hidden window without DPI scaling, to get exactly the requested framebuffer size.
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_FALSE);
+        window_ = glfwCreateWindow(headless_->width, headless_->height, title, nullptr, nullptr);
+    } else {
+        glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
+        window_ = glfwCreateWindow(initWindowSizeWidth, initWindowSizeHeight, title, nullptr, nullptr);
+    }
     if (!window_) {
         Core::terminateGLFW();
         throw std::runtime_error("GLFW window creation failed!");
     }
 
     glfwMakeContextCurrent(window_);
+    if (headless_.has_value()) {
+        // Do not let vsync limit the measured frame times.
+        glfwSwapInterval(0);
+    }
 
     int gladGLVersion = gladLoadGL(glfwGetProcAddress);
     if (gladGLVersion == 0) {
@@ -144,6 +211,7 @@ Core::~Core() {
     // Delete active plugin here, before destroying the OpenGL context.
     camera_.reset();
     currentPlugin_ = nullptr;
+    Profiler::instance().releaseGLResources();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -158,13 +226,20 @@ void Core::run() {
         throw std::runtime_error("Core is already running!");
     }
     running_ = true;
+    if (headless_.has_value()) {
+        runHeadless();
+        running_ = false;
+        return;
+    }
     while (!glfwWindowShouldClose(window_)) {
         if (fps_.tick()) {
             std::string windowTitle = std::string(title) + " [ " + fps_.getFpsString() + " ]";
             glfwSetWindowTitle(window_, windowTitle.c_str());
         }
 
+        Profiler::instance().beginFrame();
         draw();
+        Profiler::instance().endFrame();
 
         glfwSwapBuffers(window_);
         glfwPollEvents();
@@ -187,6 +262,10 @@ bool Core::isMouseButtonPressed(MouseButton button) const {
     return glfwGetMouseButton(window_, static_cast<int>(button)) == GLFW_PRESS;
 }
 
+FrameStatistics Core::getFrameStatistics() const {
+    return fps_.getStatistics();
+}
+
 void Core::getMousePos(double& xpos, double& ypos) const {
     glfwGetCursorPos(window_, &xpos, &ypos);
     scaleWindowPosToFramebufferPos(xpos, ypos);
@@ -237,6 +316,7 @@ void Core::validateImGuiScale() {
 }
 
 void Core::draw() {
+    Profiler::CpuZone drawZone("Core::draw");
     validateImGuiScale();
 
     ImGui_ImplOpenGL3_NewFrame();
@@ -251,11 +331,52 @@ void Core::draw() {
     if (ImGui::CollapsingHeader("Plugins", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Combo("Plugin", &pluginSelectionIdx_, pluginNamesImGui_.data());
     }
+    if (ImGui::CollapsingHeader("Frame Statistics")) {
+        int windowSize = static_cast<int>(fps_.getWindowSize());
+        if (ImGui::InputInt("Window", &windowSize, 10, 100)) {
+            fps_.setWindowSize(static_cast<std::size_t>(std::clamp(windowSize, 2, 100000)));
+        }
+        const FrameStatistics stats = fps_.getStatistics();
+        ImGui::Text("Last %zu frames:", stats.numFrames);
+        ImGui::Text("min %.2f / mean %.2f / max %.2f ms", stats.minMs, stats.meanMs, stats.maxMs);
+        ImGui::Text("p50 %.2f / p95 %.2f / p99 %.2f ms", stats.p50Ms, stats.p95Ms, stats.p99Ms);
+        ImGui::Text("Stutters (> %.2f ms): %zu", stats.stutterThresholdMs, stats.numStutters);
+        std::vector<float> histogram(stats.histogram.begin(), stats.histogram.end());
+        ImGui::PlotHistogram("##FrameTimeHistogram", histogram.data(), static_cast<int>(histogram.size()), 0,
+            nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+        ImGui::Text("0 - %.2f ms", stats.histogramBinWidthMs * static_cast<double>(stats.histogram.size()));
+    }
+    Profiler::instance().drawGUI();
+    if (ImGui::CollapsingHeader("Resource Cache")) {
+        auto& cache = ResourceCache::instance();
+        int budgetMB = static_cast<int>(cache.getBudget() >> 20u);
+        if (ImGui::InputInt("Budget [MB]", &budgetMB, 16, 128)) {
+            cache.setBudget(static_cast<std::size_t>(std::max(budgetMB, 0)) << 20u);
+        }
+        ImGui::Text("Used: %.2f MB", static_cast<double>(cache.getSize()) / (1024.0 * 1024.0));
+        ImGui::Text("Hits: %zu / Misses: %zu", cache.getHits(), cache.getMisses());
+        if (ImGui::Button("Clear")) {
+            cache.clear();
+        }
+    }
+    if (ImGui::CollapsingHeader("Shader Cache")) {
+        auto& cache = ShaderCache::instance();
+        bool enabled = cache.isEnabled();
+        if (ImGui::Checkbox("Enabled", &enabled)) {
+            cache.setEnabled(enabled);
+        }
+        ImGui::TextWrapped("Directory: %s", cache.getDirectory().string().c_str());
+        ImGui::Text("Hits: %zu / Misses: %zu", cache.getHits(), cache.getMisses());
+        if (ImGui::Button("Clear##ShaderCache")) {
+            cache.clear();
+        }
+    }
     if (currentPluginIdx_ != pluginSelectionIdx_) {
         currentPluginIdx_ = pluginSelectionIdx_;
         // Need to delete plugin first, so destructor of old plugin runs before constructor of new plugin.
         // Otherwise, this could mess up OpenGL states.
         currentPlugin_ = nullptr;
+        inputQueue_.clear();
 
         // Init new plugin
         const auto& plugin = PluginRegister::get(currentPluginIdx_);
@@ -270,20 +391,139 @@ void Core::draw() {
             currentPluginResourcesPath_.clear();
         }
 
+        Profiler::GpuZone createZone("Plugin::create");
         currentPlugin_ = plugin->create(*this);
         // Plugin needs to know window size.
         currentPlugin_->resize(framebufferWidth_, framebufferHeight_);
     }
 
+    {
+        Profiler::GpuZone loaderZone("ResourceLoader::update");
+        resourceLoader_.update(resourceUploadBudgetMs);
+    }
+    {
+        Profiler::CpuZone reloaderZone("ShaderReloader::update");
+        shaderReloader_.update();
+    }
+    {
+        Profiler::GpuZone inputZone("Plugin::inputEvents");
+        dispatchInputEvents();
+    }
+
     glClear(GL_COLOR_BUFFER_BIT);
 
     if (currentPlugin_ != nullptr) {
-        currentPlugin_->render();
+        // Plugins are not rendered until all their resources requested in the background are available.
+        const std::size_t numPending = resourceLoader_.numPending(currentPlugin_.get());
+        if (numPending > 0) {
+            ImGui::Text("Loading resources (%zu pending) ...", numPending);
+        } else {
+            Profiler::GpuZone renderZone("Plugin::render");
+            currentPlugin_->render();
+        }
     }
 
     ImGui::End();
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        Profiler::GpuZone imguiZone("ImGui");
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+}
+
+void Core::runHeadless() {
+    const int numFrames = headless_->numWarmupFrames + headless_->numFrames;
+    if (!headless_->tracePath.empty()) {
+        Profiler::instance().setEnabled(true);
+    }
+
+    // GPU times are measured with timestamp queries around each frame. Results are read back with a latency of a few
+    // frames, so reading does not stall the pipeline. Timestamps are used instead of GL_TIME_ELAPSED, because elapsed
+    // queries cannot be nested and plugins may want to use their own.
+    std::array<GLuint, 2 * headlessQueryLatency> queries{};
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+
+    // Construct the plugin and wait for its background resources. This is not part of the measurement.
+    do {
+        draw();
+        glfwSwapBuffers(window_);
+        glfwPollEvents();
+    } while (resourceLoader_.numPending() > 0 && !glfwWindowShouldClose(window_));
+
+    std::vector<double> cpuTimes;
+    std::vector<double> gpuTimes;
+    cpuTimes.reserve(headless_->numFrames);
+    gpuTimes.reserve(headless_->numFrames);
+
+    auto readGpuTime = [&](int frame) {
+        const std::size_t slot = 2 * (static_cast<std::size_t>(frame) % headlessQueryLatency);
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[slot + 1], GL_QUERY_RESULT, &end);
+        if (frame >= headless_->numWarmupFrames) {
+            gpuTimes.push_back(static_cast<double>(end - start) * 1.0e-6);
+        }
+    };
+
+    // Frames whose timestamp queries were issued, fewer than numFrames if the window is closed early.
+    int numSubmitted = 0;
+    for (int frame = 0; frame < numFrames && !glfwWindowShouldClose(window_); frame++) {
+        if (frame >= static_cast<int>(headlessQueryLatency)) {
+            readGpuTime(frame - static_cast<int>(headlessQueryLatency));
+        }
+        const std::size_t slot = 2 * (static_cast<std::size_t>(frame) % headlessQueryLatency);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        glQueryCounter(queries[slot], GL_TIMESTAMP);
+
+        fps_.tick();
+        Profiler::instance().beginFrame();
+        draw();
+        Profiler::instance().endFrame();
+
+        glQueryCounter(queries[slot + 1], GL_TIMESTAMP);
+        numSubmitted++;
+        glfwSwapBuffers(window_);
+        glfwPollEvents();
+        const auto end = std::chrono::high_resolution_clock::now();
+
+        if (frame >= headless_->numWarmupFrames) {
+            cpuTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+    }
+    // Collect remaining GPU results.
+    for (int frame = std::max(0, numSubmitted - static_cast<int>(headlessQueryLatency)); frame < numSubmitted; frame++) {
+        readGpuTime(frame);
+    }
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+
+    if (!headless_->tracePath.empty()) {
+        Profiler::instance().writeChromeTrace(headless_->tracePath);
+    }
+
+    std::ofstream file(headless_->reportPath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write report file \"" + headless_->reportPath.string() + "\"!");
+    }
+    writeHeadlessReport(file, cpuTimes, gpuTimes);
+    std::cout << "Headless report written to: " << headless_->reportPath.string() << std::endl;
+}
+
+void Core::writeHeadlessReport(std::ostream& out, const std::vector<double>& cpuTimes,
+    const std::vector<double>& gpuTimes) const {
+    out << std::fixed << std::setprecision(4);
+    out << "{\n";
+    out << "  \"plugin\": \"" << headless_->pluginName << "\",\n";
+    out << "  \"renderer\": \"" << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << "\",\n";
+    out << "  \"width\": " << framebufferWidth_ << ",\n";
+    out << "  \"height\": " << framebufferHeight_ << ",\n";
+    out << "  \"warmup_frames\": " << headless_->numWarmupFrames << ",\n";
+    out << "  \"frames\": " << cpuTimes.size() << ",\n";
+    writeTimingsJson(out, "cpu", cpuTimes);
+    out << ",\n";
+    writeTimingsJson(out, "gpu", gpuTimes);
+    out << "\n}" << std::endl;
 }
 
 void Core::windowSizeEvent(int width, int height) {
@@ -303,71 +543,114 @@ void Core::framebufferSizeEvent(int width, int height) {
 void Core::keyEvent(int key, [[maybe_unused]] int scancode, int action, int mods) {
     mods = GLFWUtil::fixKeyboardMods(mods, key, action);
     if (!ImGui::GetIO().WantCaptureKeyboard && currentPlugin_ != nullptr) {
-        currentPlugin_->keyboard(static_cast<Key>(key), static_cast<KeyAction>(action), Mods(mods));
+        InputEvent event;
+        event.type = InputEvent::Type::Key;
+        event.key = static_cast<Key>(key);
+        event.keyAction = static_cast<KeyAction>(action);
+        event.mods = Mods(mods);
+        queueInputEvent(event, false);
     }
 }
 
 void Core::charEvent(unsigned int codepoint) {
     if (!ImGui::GetIO().WantTextInput && currentPlugin_ != nullptr) {
-        currentPlugin_->charInput(codepoint);
+        InputEvent event;
+        event.type = InputEvent::Type::Char;
+        event.codepoint = codepoint;
+        queueInputEvent(event, false);
     }
 }
 
 void Core::mouseButtonEvent(int button, int action, int mods) {
-    auto b = static_cast<MouseButton>(button);
-    auto a = static_cast<MouseButtonAction>(action);
-    Mods m(mods);
-
-    cameraControlMode_ = AbstractCamera::MouseControlMode::None;
-    if (a == MouseButtonAction::Press && m.none()) {
-        if (b == MouseButton::Left) {
-            cameraControlMode_ = AbstractCamera::MouseControlMode::Left;
-        } else if (b == MouseButton::Middle) {
-            cameraControlMode_ = AbstractCamera::MouseControlMode::Middle;
-        } else if (b == MouseButton::Right) {
-            cameraControlMode_ = AbstractCamera::MouseControlMode::Right;
-        }
-    }
-
-    if (!ImGui::GetIO().WantCaptureMouse && currentPlugin_ != nullptr) {
-        currentPlugin_->mouseButton(b, a, m);
-    }
+    InputEvent event;
+    event.type = InputEvent::Type::MouseButton;
+    event.button = static_cast<MouseButton>(button);
+    event.buttonAction = static_cast<MouseButtonAction>(action);
+    event.mods = Mods(mods);
+    queueInputEvent(event, ImGui::GetIO().WantCaptureMouse);
 }
 
 void Core::mouseMoveEvent(double xpos, double ypos) {
     scaleWindowPosToFramebufferPos(xpos, ypos);
 
-    if (!ImGui::GetIO().WantCaptureMouse && currentPlugin_ != nullptr) {
-        // Check camera event in mouseButtonEvent for correct modifier state. Checking here just for current key status
-        // with glfwGetKey will miss the state when the modifier key was pressed before the window gets the focus. The
-        // reason for this is, that glfwGetKey only returns a cached state, while the modifiers parameter contains the
-        // live status.
-        if (cameraControlMode_ != AbstractCamera::MouseControlMode::None) {
+    InputEvent event;
+    event.type = InputEvent::Type::MouseMove;
+    event.x = xpos;
+    event.y = ypos;
+    queueInputEvent(event, ImGui::GetIO().WantCaptureMouse);
+}
+
+void Core::mouseScrollEvent(double xoffset, double yoffset) {
+    InputEvent event;
+    event.type = InputEvent::Type::MouseScroll;
+    event.x = xoffset;
+    event.y = yoffset;
+    queueInputEvent(event, ImGui::GetIO().WantCaptureMouse);
+}
+
+void Core::queueInputEvent(const InputEvent& event, bool capturedByGui) {
+    // GLFW may report dozens of cursor or scroll events per frame. Merge consecutive ones, so plugins and camera only
+    // react once per frame. Events of other types in between keep their order.
+    if (!inputQueue_.empty() && inputQueue_.back().event.type == event.type &&
+        inputQueue_.back().capturedByGui == capturedByGui) {
+        InputEvent& last = inputQueue_.back().event;
+        if (event.type == InputEvent::Type::MouseMove) {
+            last.x = event.x;
+            last.y = event.y;
+            return;
+        }
+        if (event.type == InputEvent::Type::MouseScroll) {
+            last.x += event.x;
+            last.y += event.y;
+            return;
+        }
+    }
+    inputQueue_.push_back({event, capturedByGui});
+}
+
+void Core::dispatchInputEvents() {
+    std::vector<InputEvent> pluginEvents;
+    for (const auto& [event, capturedByGui] : inputQueue_) {
+        if (event.type == InputEvent::Type::MouseButton) {
+            cameraControlMode_ = AbstractCamera::MouseControlMode::None;
+            if (event.buttonAction == MouseButtonAction::Press && event.mods.none()) {
+                if (event.button == MouseButton::Left) {
+                    cameraControlMode_ = AbstractCamera::MouseControlMode::Left;
+                } else if (event.button == MouseButton::Middle) {
+                    cameraControlMode_ = AbstractCamera::MouseControlMode::Middle;
+                } else if (event.button == MouseButton::Right) {
+                    cameraControlMode_ = AbstractCamera::MouseControlMode::Right;
+                }
+            }
+        } else if (event.type == InputEvent::Type::MouseMove) {
+            // Camera mode is set from the button event for correct modifier state. Checking here just for current key
+            // status with glfwGetKey will miss the state when the modifier key was pressed before the window gets the
+            // focus. The reason for this is, that glfwGetKey only returns a cached state, while the modifiers
+            // parameter contains the live status.
             auto camera = camera_.lock();
-            if (camera) {
+            if (!capturedByGui && camera && cameraControlMode_ != AbstractCamera::MouseControlMode::None) {
                 double oldX = 2.0 * mouseX_ / static_cast<double>(framebufferWidth_) - 1.0;
                 double oldY = 1.0 - 2.0 * mouseY_ / static_cast<double>(framebufferHeight_);
-                double newX = 2.0 * xpos / static_cast<double>(framebufferWidth_) - 1.0;
-                double newY = 1.0 - 2.0 * ypos / static_cast<double>(framebufferHeight_);
+                double newX = 2.0 * event.x / static_cast<double>(framebufferWidth_) - 1.0;
+                double newY = 1.0 - 2.0 * event.y / static_cast<double>(framebufferHeight_);
                 camera->mouseMoveControl(cameraControlMode_, oldX, oldY, newX, newY);
             }
-        }
-
-        currentPlugin_->mouseMove(xpos, ypos);
-    }
-    mouseX_ = xpos;
-    mouseY_ = ypos;
-}
-
-void Core::mouseScrollEvent(double xoffset, double yoffset) {
-    if (!ImGui::GetIO().WantCaptureMouse && currentPlugin_ != nullptr) {
-        if (!GLFWUtil::anyModKeyPressed(window_)) {
+            mouseX_ = event.x;
+            mouseY_ = event.y;
+        } else if (event.type == InputEvent::Type::MouseScroll) {
             auto camera = camera_.lock();
-            if (camera) {
-                camera->mouseScrollControl(xoffset, yoffset);
+            if (!capturedByGui && camera && !GLFWUtil::anyModKeyPressed(window_)) {
+                camera->mouseScrollControl(event.x, event.y);
             }
         }
-        currentPlugin_->mouseScroll(xoffset, yoffset);
+        if (!capturedByGui) {
+            pluginEvents.push_back(event);
+        }
+    }
+    inputQueue_.clear();
+
+    if (currentPlugin_ != nullptr && !pluginEvents.empty()) {
+        currentPlugin_->inputEvents(pluginEvents);
     }
 }
 
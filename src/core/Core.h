@@ -3,6 +3,9 @@
 #include <exception>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
 #include <vector>
 
 // clang-format off
@@ -12,20 +15,38 @@
 
 #include "camera/AbstractCamera.h"
 #include "Input.h"
+#include "ResourceLoader.h"
+#include "ShaderReloader.h"
 #include "util/FpsCounter.h"
 
 namespace OGL4Core2::Core {
     class RenderPlugin;
 
+    /**
+     * Settings for running a single plugin unattended. The window is hidden, the framebuffer has a fixed size and a
+     * fixed number of frames is rendered. Afterwards a JSON report with the frame timings is written.
+     */
+    struct HeadlessOptions {
+        std::string pluginName;                           //!< plugin name as returned by its name() function
+        int numFrames = 300;                              //!< number of measured frames
+        int numWarmupFrames = 10;                         //!< unmeasured frames, includes plugin construction
+        int width = 1280;                                 //!< framebuffer width
+        int height = 800;                                 //!< framebuffer height
+        std::filesystem::path reportPath = "report.json"; //!< JSON report output file
+        std::filesystem::path tracePath;                  //!< Chrome trace output file, no trace if empty
+    };
+
     class Core {
     public:
-        Core();
+        explicit Core(std::optional<HeadlessOptions> headlessOptions = std::nullopt);
         ~Core();
 
         void run();
 
         [[nodiscard]] std::filesystem::path getPluginResourcesPath() const;
 
+        [[nodiscard]] FrameStatistics getFrameStatistics() const;
+
         [[nodiscard]] bool isKeyPressed(Key key) const;
         [[nodiscard]] bool isMouseButtonPressed(MouseButton button) const;
         void getMousePos(double& xpos, double& ypos) const;
@@ -35,10 +56,22 @@ namespace OGL4Core2::Core {
         void registerCamera(const std::shared_ptr<AbstractCamera>& camera) const;
         void removeCamera() const;
 
+        [[nodiscard]] ResourceLoader& getResourceLoader() const {
+            return resourceLoader_;
+        }
+
+        [[nodiscard]] ShaderReloader& getShaderReloader() const {
+            return shaderReloader_;
+        }
+
     private:
         void validateImGuiScale();
         void draw();
 
+        void runHeadless();
+        void writeHeadlessReport(std::ostream& out, const std::vector<double>& cpuTimes,
+            const std::vector<double>& gpuTimes) const;
+
         void windowSizeEvent(int width, int height);
         void framebufferSizeEvent(int width, int height);
         void keyEvent(int key, int scancode, int action, int mods);
@@ -49,11 +82,18 @@ namespace OGL4Core2::Core {
 
         void scaleWindowPosToFramebufferPos(double& xpos, double& ypos) const;
 
+        void queueInputEvent(const InputEvent& event, bool capturedByGui);
+        void dispatchInputEvents();
+
         GLFWwindow* window_;
         bool running_;
+        std::optional<HeadlessOptions> headless_;
 
         FpsCounter fps_;
 
+        mutable ResourceLoader resourceLoader_;
+        mutable ShaderReloader shaderReloader_;
+
         std::shared_ptr<RenderPlugin> currentPlugin_;
         std::filesystem::path currentPluginResourcesPath_;
         std::exception currentPluginResourcesPathException_;
@@ -75,6 +115,12 @@ namespace OGL4Core2::Core {
         double mouseY_;
 
         AbstractCamera::MouseControlMode cameraControlMode_;
+
+        struct QueuedInputEvent {
+            InputEvent event;
+            bool capturedByGui;
+        };
+        std::vector<QueuedInputEvent> inputQueue_; //!< events since last frame, dispatched before rendering
         mutable std::weak_ptr<AbstractCamera> camera_;
 
         static void initGLFW();
@@ -207,4 +207,27 @@ namespace OGL4Core2::Core {
         Right = GLFW_MOUSE_BUTTON_RIGHT,
         Middle = GLFW_MOUSE_BUTTON_MIDDLE,
     };
+
+    /**
+     * Input event queued by the Core between two frames. Only the members matching the type are valid.
+     */
+    struct InputEvent {
+        enum class Type {
+            Key,
+            Char,
+            MouseButton,
+            MouseMove,
+            MouseScroll,
+        };
+
+        Type type = Type::Key;
+        Key key = Key::Unknown;
+        KeyAction keyAction = KeyAction::Release;
+        MouseButton button = MouseButton::Left;
+        MouseButtonAction buttonAction = MouseButtonAction::Release;
+        Mods mods;
+        unsigned int codepoint = 0;
+        double x = 0.0; //!< MouseMove: x position, MouseScroll: x offset
+        double y = 0.0; //!< MouseMove: y position, MouseScroll: y offset
+    };
 } // namespace OGL4Core2::Core
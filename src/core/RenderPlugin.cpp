@@ -1,20 +1,42 @@
 #include "RenderPlugin.h"
 
 #include <algorithm>
-#include <fstream>
+#include <chrono>
+#include <future>
+#include <iostream>
 #include <regex>
-#include <sstream>
 #include <stdexcept>
 #include <utility>
 
-#include <lodepng.h>
-
 #include "Core.h"
+#include "util/Profiler.h"
+#include "util/ResourceCache.h"
 
 using namespace OGL4Core2::Core;
 
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::shared_ptr<glowl::Texture2D> createTexture(const std::string& name, const ResourceCache::Image& image) {
+    glowl::TextureLayout layout(GL_RGBA8, image.width, image.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, 1,
+        {
+            {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
+            {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE},
+            {GL_TEXTURE_MIN_FILTER, GL_LINEAR},
+            {GL_TEXTURE_MAG_FILTER, GL_LINEAR},
+        },
+        {});
+    return std::make_shared<glowl::Texture2D>(name, layout, image.data.data());
+}
+
 RenderPlugin::RenderPlugin(const Core& c) : core_(c) {}
 
+RenderPlugin::~RenderPlugin() {
+    core_.getResourceLoader().cancel(this);
+    core_.getShaderReloader().unwatch(this);
+}
+
 void RenderPlugin::resize([[maybe_unused]] int width, [[maybe_unused]] int height) {}
 
 void RenderPlugin::keyboard([[maybe_unused]] Key key, [[maybe_unused]] KeyAction action, [[maybe_unused]] Mods mods) {}
@@ -28,6 +50,28 @@ void RenderPlugin::mouseMove([[maybe_unused]] double xpos, [[maybe_unused]] doub
 
 void RenderPlugin::mouseScroll([[maybe_unused]] double xoffset, [[maybe_unused]] double yoffset) {}
 
+void RenderPlugin::inputEvents(const std::vector<InputEvent>& events) {
+    for (const auto& event : events) {
+        switch (event.type) {
+            case InputEvent::Type::Key:
+                keyboard(event.key, event.keyAction, event.mods);
+                break;
+            case InputEvent::Type::Char:
+                charInput(event.codepoint);
+                break;
+            case InputEvent::Type::MouseButton:
+                mouseButton(event.button, event.buttonAction, event.mods);
+                break;
+            case InputEvent::Type::MouseMove:
+                mouseMove(event.x, event.y);
+                break;
+            case InputEvent::Type::MouseScroll:
+                mouseScroll(event.x, event.y);
+                break;
+        }
+    }
+}
+
 std::filesystem::path RenderPlugin::getResourcePath(const std::string& name) const {
     auto basePath = core_.getPluginResourcesPath();
 
@@ -57,41 +101,62 @@ std::filesystem::path RenderPlugin::getResourceDirPath(const std::string& name)
 }
 
 std::string RenderPlugin::getStringResource(const std::string& name) const {
-    std::filesystem::path path = getResourceFilePath(name);
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot read resource file \"" + path.string() + "\"!");
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    return *ResourceCache::instance().getFile(getResourceFilePath(name));
+}
+
+MappedFile RenderPlugin::mapResource(const std::string& name) const {
+    return MappedFile(getResourceFilePath(name));
 }
 
 std::vector<unsigned char> RenderPlugin::getPngResource(const std::string& name, int& width, int& height) const {
-    std::vector<unsigned char> image;
-    unsigned int w, h;
-    unsigned int error = lodepng::decode(image, w, h, getResourceFilePath(name).string());
-    if (error != 0) {
-        std::string errorText = lodepng_error_text(error);
-        throw std::runtime_error("Cannot load PNG resource: " + errorText);
-    }
-    width = static_cast<int>(w);
-    height = static_cast<int>(h);
-    return image;
+    auto image = ResourceCache::instance().getPng(getResourceFilePath(name));
+    width = image->width;
+    height = image->height;
+    return image->data;
 }
 
 std::shared_ptr<glowl::Texture2D> RenderPlugin::getTextureResource(const std::string& name) const {
-    int width, height;
-    std::vector<unsigned char> image = getPngResource(name, width, height);
-    glowl::TextureLayout layout(GL_RGBA8, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, 1,
-        {
-            {GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE},
-            {GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE},
-            {GL_TEXTURE_MIN_FILTER, GL_LINEAR},
-            {GL_TEXTURE_MAG_FILTER, GL_LINEAR},
-        },
-        {});
-    return std::make_shared<glowl::Texture2D>(name, layout, image.data());
+    // Use the cached image directly, no need to copy it for the upload.
+    auto image = ResourceCache::instance().getPng(getResourceFilePath(name));
+    return createTexture(name, *image);
+}
+
+std::vector<std::shared_ptr<glowl::Texture2D>> RenderPlugin::getTextureResources(
+    const std::vector<std::string>& names) const {
+    Profiler::CpuZone profilerZone("RenderPlugin::getTextureResources");
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    struct DecodedImage {
+        std::shared_ptr<const ResourceCache::Image> image;
+        double decodeMs;
+    };
+
+    // Decode on the workers of the resource loader. Paths are resolved here, so missing files throw on the caller.
+    ThreadPool& pool = core_.getResourceLoader().threadPool();
+    std::vector<std::future<DecodedImage>> decodes;
+    decodes.reserve(names.size());
+    for (const auto& name : names) {
+        decodes.emplace_back(pool.submit([path = getResourceFilePath(name)]() {
+            const auto decodeStart = std::chrono::high_resolution_clock::now();
+            DecodedImage decoded;
+            decoded.image = ResourceCache::instance().getPng(path);
+            decoded.decodeMs = elapsedMs(decodeStart);
+            return decoded;
+        }));
+    }
+
+    // Upload in order as soon as each image is available.
+    std::vector<std::shared_ptr<glowl::Texture2D>> textures;
+    textures.reserve(names.size());
+    for (std::size_t i = 0; i < names.size(); i++) {
+        DecodedImage decoded = decodes[i].get();
+        std::cout << "Decoded texture \"" << names[i] << "\" (" << decoded.image->width << "x"
+                  << decoded.image->height << ") in " << decoded.decodeMs << " ms" << std::endl;
+        textures.push_back(createTexture(names[i], *decoded.image));
+    }
+    std::cout << "Loaded " << names.size() << " textures on " << pool.size() << " threads in " << elapsedMs(start)
+              << " ms" << std::endl;
+    return textures;
 }
 
 std::vector<std::filesystem::path> RenderPlugin::getResourceDirFilePaths(const std::string& name,
@@ -112,3 +177,25 @@ std::vector<std::filesystem::path> RenderPlugin::getResourceDirFilePaths(const s
     std::sort(files.begin(), files.end());
     return files;
 }
+
+void RenderPlugin::createShaderProgram(std::unique_ptr<glowl::GLSLProgram>& program, const ShaderFileList& files) {
+    ShaderReloader::ShaderFileList paths;
+    for (const auto& [type, name] : files) {
+        paths.emplace_back(type, getResourceFilePath(name));
+    }
+    // Watch before compiling, so fixing a broken shader file triggers a reload as well.
+    core_.getShaderReloader().watch(this, program, paths);
+    program = ShaderReloader::compile(paths);
+}
+
+void RenderPlugin::uploadResourceAsync(std::function<bool()> step) {
+    core_.getResourceLoader().submitUpload(this, std::move(step));
+}
+
+bool RenderPlugin::isLoadingResources() const {
+    return core_.getResourceLoader().numPending(this) > 0;
+}
+
+void RenderPlugin::submitResourceJob(std::function<void()> load, std::function<void()> finish) {
+    core_.getResourceLoader().submit(this, std::move(load), std::move(finish));
+}
@@ -1,14 +1,18 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glad/gl.h>
 #include <glowl/glowl.h>
 
 #include "Input.h"
+#include "util/MappedFile.h"
 
 namespace OGL4Core2::Core {
     class Core;
@@ -16,7 +20,7 @@ namespace OGL4Core2::Core {
     class RenderPlugin {
     public:
         explicit RenderPlugin(const Core& c);
-        virtual ~RenderPlugin() = default;
+        virtual ~RenderPlugin();
 
         virtual void render() = 0;
 
@@ -27,16 +31,68 @@ namespace OGL4Core2::Core {
         virtual void mouseMove(double xpos, double ypos);
         virtual void mouseScroll(double xoffset, double yoffset);
 
+        /**
+         * Called once per frame before render() with all input events since the last frame, in order. Consecutive
+         * mouse moves are merged into the last position and consecutive scrolls into the summed offset. The default
+         * implementation calls the single event handlers above, so their expensive reactions (e.g. buffer uploads)
+         * run once per frame. Override it to handle the whole batch at once.
+         */
+        virtual void inputEvents(const std::vector<InputEvent>& events);
+
         [[nodiscard]] std::filesystem::path getResourcePath(const std::string& name) const;
         [[nodiscard]] std::filesystem::path getResourceFilePath(const std::string& name) const;
         [[nodiscard]] std::filesystem::path getResourceDirPath(const std::string& name) const;
         [[nodiscard]] std::string getStringResource(const std::string& name) const;
+        /**
+         * Map a resource file read-only into memory. In contrast to getStringResource() nothing is copied, pages are
+         * read from the page cache on access. The view is valid as long as the returned object lives.
+         */
+        [[nodiscard]] MappedFile mapResource(const std::string& name) const;
         [[nodiscard]] std::vector<unsigned char> getPngResource(const std::string& name, int& width, int& height) const;
         [[nodiscard]] std::shared_ptr<glowl::Texture2D> getTextureResource(const std::string& name) const;
+        /**
+         * Load several PNG textures at once. The images are decoded concurrently on the thread pool of the resource
+         * loader and uploaded on the calling thread, which therefore must be the render thread. Decode times are
+         * printed per texture. The returned textures are in the order of `names`.
+         */
+        [[nodiscard]] std::vector<std::shared_ptr<glowl::Texture2D>> getTextureResources(
+            const std::vector<std::string>& names) const;
         [[nodiscard]] std::vector<std::filesystem::path> getResourceDirFilePaths(const std::string& name,
             const std::string& filter = std::string()) const;
 
+        using ShaderFileList = std::vector<std::pair<glowl::GLSLProgram::ShaderType, std::string>>;
+
+        /**
+         * Create a shader program from resource files (names as in getResourceFilePath()) and watch the files for
+         * changes. If a file is modified, only the affected programs are recompiled and assigned to `program`, which
+         * therefore must live as long as the plugin. If compilation fails, glowl::GLSLProgramException is thrown and
+         * `program` keeps its previous value, both here and on hot reload.
+         */
+        void createShaderProgram(std::unique_ptr<glowl::GLSLProgram>& program, const ShaderFileList& files);
+
+        /**
+         * Load a resource in the background. `load` runs on a worker thread and must not use OpenGL or modify the
+         * plugin. Its result is passed to `finish` on the render thread, where OpenGL can be used. The Core does not
+         * call render() while resources of the plugin are pending. Pending loads are cancelled on plugin destruction.
+         */
+        template<typename T>
+        void loadResourceAsync(std::function<T()> load, std::function<void(T&)> finish) {
+            auto result = std::make_shared<std::optional<T>>();
+            submitResourceJob([load = std::move(load), result]() { result->emplace(load()); },
+                [finish = std::move(finish), result]() { finish(**result); });
+        }
+
+        /**
+         * Add an upload step, which is called on the render thread once per frame (within the per frame upload
+         * budget of the Core) until it returns true. Use it to split large GL uploads into slices.
+         */
+        void uploadResourceAsync(std::function<bool()> step);
+
+        [[nodiscard]] bool isLoadingResources() const;
+
     protected:
+        void submitResourceJob(std::function<void()> load, std::function<void()> finish);
+
         const Core& core_;
     };
 } // namespace OGL4Core2::Core
@@ -0,0 +1,146 @@
+#include "ResourceLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+using namespace OGL4Core2::Core;
+
+static void printLoaderError(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& ex) {
+        std::cerr << "Resource loading failed: " << ex.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Resource loading failed: Unknown error!" << std::endl;
+    }
+}
+
+ResourceLoader::ResourceLoader(std::size_t numThreads) : pool_(numThreads) {}
+
+ResourceLoader::~ResourceLoader() {
+    // Skip load stages of queued jobs, the thread pool joins its workers afterwards.
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& job : runningJobs_) {
+        job->cancelled = true;
+    }
+}
+
+void ResourceLoader::submit(const void* owner, std::function<void()> load, std::function<void()> finish) {
+    auto job = std::make_shared<Job>();
+    job->owner = owner;
+    job->load = std::move(load);
+    job->finish = std::move(finish);
+    job->cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        runningJobs_.push_back(job);
+    }
+    pool_.submit([this, job]() {
+        if (!job->cancelled) {
+            try {
+                job->load();
+            } catch (...) {
+                job->error = std::current_exception();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        runningJobs_.erase(std::find(runningJobs_.begin(), runningJobs_.end(), job));
+        if (!job->cancelled) {
+            finishedJobs_.push_back(job);
+        }
+    });
+}
+
+void ResourceLoader::submitUpload(const void* owner, UploadStep step) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uploads_.push_back({owner, std::move(step)});
+}
+
+void ResourceLoader::update(double budgetMs) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    bool first = true;
+    auto inBudget = [&]() {
+        return first ||
+               std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() <
+                   budgetMs;
+    };
+
+    // Callbacks are executed without holding the lock, they may submit new jobs or uploads.
+    while (inBudget()) {
+        std::shared_ptr<Job> job;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finishedJobs_.empty()) {
+                break;
+            }
+            job = std::move(finishedJobs_.front());
+            finishedJobs_.pop_front();
+        }
+        first = false;
+        if (job->error) {
+            printLoaderError(job->error);
+            continue;
+        }
+        try {
+            job->finish();
+        } catch (...) {
+            printLoaderError(std::current_exception());
+        }
+    }
+
+    while (inBudget()) {
+        Upload upload;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (uploads_.empty()) {
+                break;
+            }
+            upload = std::move(uploads_.front());
+            uploads_.pop_front();
+        }
+        first = false;
+        bool done = true;
+        try {
+            done = upload.step();
+        } catch (...) {
+            printLoaderError(std::current_exception());
+        }
+        if (!done) {
+            // Keep order of steps, continue with the same upload.
+            std::lock_guard<std::mutex> lock(mutex_);
+            uploads_.push_front(std::move(upload));
+        }
+    }
+}
+
+void ResourceLoader::cancel(const void* owner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& job : runningJobs_) {
+        if (job->owner == owner) {
+            job->cancelled = true;
+        }
+    }
+    finishedJobs_.erase(std::remove_if(finishedJobs_.begin(), finishedJobs_.end(),
+                            [owner](const auto& job) { return job->owner == owner; }),
+        finishedJobs_.end());
+    uploads_.erase(std::remove_if(uploads_.begin(), uploads_.end(),
+                       [owner](const auto& upload) { return upload.owner == owner; }),
+        uploads_.end());
+}
+
+std::size_t ResourceLoader::numPending(const void* owner) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto isOwner = [owner](const auto& job) { return job->owner == owner && !job->cancelled; };
+    return static_cast<std::size_t>(std::count_if(runningJobs_.begin(), runningJobs_.end(), isOwner) +
+                                    std::count_if(finishedJobs_.begin(), finishedJobs_.end(), isOwner) +
+                                    std::count_if(uploads_.begin(), uploads_.end(),
+                                        [owner](const auto& upload) { return upload.owner == owner; }));
+}
+
+std::size_t ResourceLoader::numPending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return runningJobs_.size() + finishedJobs_.size() + uploads_.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "util/ThreadPool.h"
+
+namespace OGL4Core2::Core {
+    /**
+     * Loads resources in the background. Each job has two stages: the load stage runs on a worker thread and must not
+     * use OpenGL (disk I/O, decoding, preprocessing), the finish stage runs afterwards on the render thread and may
+     * use OpenGL. Large uploads can be split into upload steps, which are executed on the render thread within a
+     * time budget per frame, so a single frame never blocks for the whole upload.
+     *
+     * All jobs belong to an owner (usually a plugin). Jobs of an owner can be cancelled, which discards all results
+     * not yet finished.
+     */
+    class ResourceLoader {
+    public:
+        /**
+         * Upload step, called once per frame until it returns true.
+         */
+        using UploadStep = std::function<bool()>;
+
+        explicit ResourceLoader(std::size_t numThreads = 0);
+        ~ResourceLoader();
+
+        ResourceLoader(const ResourceLoader&) = delete;
+        ResourceLoader& operator=(const ResourceLoader&) = delete;
+
+        void submit(const void* owner, std::function<void()> load, std::function<void()> finish);
+        void submitUpload(const void* owner, UploadStep step);
+
+        /**
+         * Must be called once per frame on the render thread. Runs finish stages of completed jobs and upload steps
+         * until the time budget is used up. At least one step is executed per call to guarantee progress.
+         * @param budgetMs time budget in milliseconds
+         */
+        void update(double budgetMs);
+
+        void cancel(const void* owner);
+
+        [[nodiscard]] std::size_t numPending(const void* owner) const;
+        [[nodiscard]] std::size_t numPending() const;
+
+        [[nodiscard]] ThreadPool& threadPool() {
+            return pool_;
+        }
+
+    private:
+        struct Job {
+            const void* owner;
+            std::function<void()> load;
+            std::function<void()> finish;
+            std::exception_ptr error;
+            std::atomic<bool> cancelled;
+        };
+
+        struct Upload {
+            const void* owner;
+            UploadStep step;
+        };
+
+        std::vector<std::shared_ptr<Job>> runningJobs_; //!< submitted, load stage not finished
+        std::deque<std::shared_ptr<Job>> finishedJobs_;  //!< load stage finished, waiting for finish stage
+        std::deque<Upload> uploads_;
+        mutable std::mutex mutex_;
+
+        ThreadPool pool_;
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,93 @@
+#include "ShaderReloader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "util/ResourceCache.h"
+#include "util/ShaderCache.h"
+
+using namespace OGL4Core2::Core;
+
+static std::string fileNames(const ShaderReloader::ShaderFileList& files) {
+    std::string names;
+    for (const auto& file : files) {
+        names += (names.empty() ? "" : ", ") + file.second.filename().string();
+    }
+    return names;
+}
+
+void ShaderReloader::watch(const void* owner, std::unique_ptr<glowl::GLSLProgram>& program,
+    const ShaderFileList& files) {
+    ShaderFileList normalizedFiles;
+    for (const auto& [type, path] : files) {
+        normalizedFiles.emplace_back(type, FileWatcher::normalizePath(path));
+    }
+    auto it = std::find_if(entries_.begin(), entries_.end(), [&](const auto& e) { return e.program == &program; });
+    if (it != entries_.end()) {
+        it->owner = owner;
+        it->files = std::move(normalizedFiles);
+    } else {
+        entries_.push_back({owner, &program, std::move(normalizedFiles)});
+    }
+    updateWatchedFiles();
+}
+
+void ShaderReloader::unwatch(const void* owner) {
+    entries_.erase(
+        std::remove_if(entries_.begin(), entries_.end(), [owner](const auto& e) { return e.owner == owner; }),
+        entries_.end());
+    updateWatchedFiles();
+}
+
+void ShaderReloader::update() {
+    const auto changedFiles = watcher_.poll();
+    if (changedFiles.empty()) {
+        return;
+    }
+    for (auto& entry : entries_) {
+        const bool affected = std::any_of(entry.files.begin(), entry.files.end(), [&](const auto& file) {
+            return std::find(changedFiles.begin(), changedFiles.end(), file.second) != changedFiles.end();
+        });
+        if (!affected) {
+            continue;
+        }
+        try {
+            *entry.program = compile(entry.files);
+            std::cout << "Reloaded shader program: " << fileNames(entry.files) << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Reloading shader program failed, keeping previous version: " << fileNames(entry.files)
+                      << std::endl
+                      << e.what() << std::endl;
+        }
+    }
+}
+
+std::unique_ptr<glowl::GLSLProgram> ShaderReloader::compile(const ShaderFileList& files) {
+    glowl::GLSLProgram::ShaderSourceList sources;
+    for (const auto& [type, path] : files) {
+        sources.emplace_back(type, *ResourceCache::instance().getFile(path));
+    }
+    return ShaderCache::instance().createProgram(sources);
+}
+
+void ShaderReloader::updateWatchedFiles() {
+    std::set<std::filesystem::path> files;
+    for (const auto& entry : entries_) {
+        for (const auto& file : entry.files) {
+            files.insert(file.second);
+        }
+    }
+    for (const auto& file : watchedFiles_) {
+        if (files.count(file) == 0) {
+            watcher_.removeFile(file);
+        }
+    }
+    for (const auto& file : files) {
+        if (std::find(watchedFiles_.begin(), watchedFiles_.end(), file) == watchedFiles_.end()) {
+            watcher_.addFile(file);
+        }
+    }
+    watchedFiles_.assign(files.begin(), files.end());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glowl/glowl.h>
+
+#include "util/FileWatcher.h"
+
+namespace OGL4Core2::Core {
+    /**
+     * Hot reload for shader programs. Programs are registered together with the files they are built from. When one
+     * of the files is modified, only the affected programs are recompiled and swapped. If compilation fails, the
+     * error is printed and the previous program is kept.
+     */
+    class ShaderReloader {
+    public:
+        using ShaderFileList = std::vector<std::pair<glowl::GLSLProgram::ShaderType, std::filesystem::path>>;
+
+        ShaderReloader() = default;
+        ~ShaderReloader() = default;
+
+        ShaderReloader(const ShaderReloader&) = delete;
+        ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+        /**
+         * Register a program for hot reload. Registering the same program again replaces its file list.
+         * @param owner   owner of the program, used to unregister all its programs with unwatch()
+         * @param program program pointer which is replaced on reload, must stay valid until unwatch() is called
+         * @param files   shader files of the program
+         */
+        void watch(const void* owner, std::unique_ptr<glowl::GLSLProgram>& program, const ShaderFileList& files);
+
+        void unwatch(const void* owner);
+
+        /**
+         * Must be called once per frame on the render thread. Recompiles programs with modified files.
+         */
+        void update();
+
+        /**
+         * Compile a program from files, using the ResourceCache and the ShaderCache.
+         * Throws glowl::GLSLProgramException on compile errors.
+         */
+        [[nodiscard]] static std::unique_ptr<glowl::GLSLProgram> compile(const ShaderFileList& files);
+
+    private:
+        struct Entry {
+            const void* owner;
+            std::unique_ptr<glowl::GLSLProgram>* program;
+            ShaderFileList files;
+        };
+
+        void updateWatchedFiles();
+
+        std::vector<Entry> entries_;
+        std::vector<std::filesystem::path> watchedFiles_;
+        FileWatcher watcher_;
+    };
+} // namespace OGL4Core2::Core
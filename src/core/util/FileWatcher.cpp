@@ -0,0 +1,120 @@
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace OGL4Core2::Core;
+
+std::filesystem::path FileWatcher::normalizePath(const std::filesystem::path& file) {
+    std::error_code ec;
+    auto path = std::filesystem::weakly_canonical(file, ec);
+    return ec ? file.lexically_normal() : path;
+}
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher() : fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+    if (fd_ < 0) {
+        std::cerr << "Cannot initialize inotify, file watching is disabled!" << std::endl;
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+void FileWatcher::addFile(const std::filesystem::path& file) {
+    const auto path = normalizePath(file);
+    files_.insert(path);
+    if (fd_ < 0) {
+        return;
+    }
+    const auto dir = path.parent_path();
+    for (const auto& [wd, watchedDir] : watchedDirs_) {
+        if (watchedDir == dir) {
+            return;
+        }
+    }
+    const int wd = inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        std::cerr << "Cannot watch directory \"" << dir.string() << "\"!" << std::endl;
+        return;
+    }
+    watchedDirs_[wd] = dir;
+}
+
+void FileWatcher::removeFile(const std::filesystem::path& file) {
+    // Directory watches are kept, they are cheap and likely needed again.
+    files_.erase(normalizePath(file));
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+    std::set<std::filesystem::path> changed;
+    if (fd_ >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(fd_, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+                auto it = watchedDirs_.find(event->wd);
+                if (it == watchedDirs_.end() || event->len == 0) {
+                    continue;
+                }
+                auto path = it->second / event->name;
+                if (files_.count(path) > 0) {
+                    changed.insert(std::move(path));
+                }
+            }
+        }
+    }
+    return {changed.begin(), changed.end()};
+}
+
+#else
+
+static constexpr std::chrono::milliseconds pollInterval(500);
+
+FileWatcher::FileWatcher() : lastPoll_(std::chrono::steady_clock::now()) {}
+
+FileWatcher::~FileWatcher() = default;
+
+void FileWatcher::addFile(const std::filesystem::path& file) {
+    const auto path = normalizePath(file);
+    files_.insert(path);
+    std::error_code ec;
+    mtimes_[path] = std::filesystem::last_write_time(path, ec);
+}
+
+void FileWatcher::removeFile(const std::filesystem::path& file) {
+    const auto path = normalizePath(file);
+    files_.erase(path);
+    mtimes_.erase(path);
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll() {
+    std::vector<std::filesystem::path> changed;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll_ < pollInterval) {
+        return changed;
+    }
+    lastPoll_ = now;
+    for (auto& [path, mtime] : mtimes_) {
+        std::error_code ec;
+        const auto current = std::filesystem::last_write_time(path, ec);
+        if (!ec && current != mtime) {
+            mtime = current;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+
+#endif
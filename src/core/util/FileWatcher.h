@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Watches a set of files for modifications. On Linux inotify is used, the parent directories of the files are
+     * watched, so files replaced by editors (write to temp file and rename) are detected as well. On other platforms
+     * the modification times are polled. poll() never blocks and must be called regularly, e.g. once per frame.
+     */
+    class FileWatcher {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        void addFile(const std::filesystem::path& file);
+        void removeFile(const std::filesystem::path& file);
+
+        /**
+         * @return files modified since the last call, each file at most once
+         */
+        [[nodiscard]] std::vector<std::filesystem::path> poll();
+
+        /**
+         * Paths are compared in canonical form, poll() returns canonical paths.
+         */
+        [[nodiscard]] static std::filesystem::path normalizePath(const std::filesystem::path& file);
+
+    private:
+        std::set<std::filesystem::path> files_;
+#ifdef __linux__
+        int fd_;
+        std::map<int, std::filesystem::path> watchedDirs_; //!< watch descriptor -> directory
+#else
+        std::map<std::filesystem::path, std::filesystem::file_time_type> mtimes_;
+        std::chrono::steady_clock::time_point lastPoll_;
+#endif
+    };
+} // namespace OGL4Core2::Core
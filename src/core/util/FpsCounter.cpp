@@ -1,36 +1,127 @@
 #include "FpsCounter.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
+#include <utility>
 
 using namespace OGL4Core2::Core;
 
 FpsCounter::FpsCounter(double updateFrequency, std::size_t bufferSize)
     : updateFrequency(updateFrequency),
       bufferSize(bufferSize),
-      currentPos(bufferSize - 1) {
+      currentPos(0),
+      numValid(0),
+      started(false),
+      stutterThresholdMs(0.0),
+      histogramNumBins(32),
+      histogramRangeMs(0.0) {
+    if (bufferSize == 0) {
+        throw std::invalid_argument("FpsCounter buffer size must not be zero!");
+    }
     auto now = std::chrono::high_resolution_clock::now();
     lastUpdate = now;
-    timestamps = std::vector<std::chrono::high_resolution_clock::time_point>(bufferSize, now);
+    lastTick = now;
+    frameTimes = std::vector<double>(bufferSize, 0.0);
 }
 
 bool FpsCounter::tick() {
     auto now = std::chrono::high_resolution_clock::now();
-    currentPos = (currentPos + 1) % bufferSize;
-    timestamps[currentPos] = now;
+    // The first tick only starts the timing, otherwise the first frame would include everything since construction,
+    // e.g. plugin and resource initialization.
+    if (!started) {
+        started = true;
+        lastUpdate = now;
+        lastTick = now;
+        return false;
+    }
+    addFrameTime(std::chrono::duration<double, std::milli>(now - lastTick).count());
+    lastTick = now;
     return std::chrono::duration<double>(now - lastUpdate).count() >= updateFrequency;
 }
 
+void FpsCounter::addFrameTime(double frameTimeMs) {
+    frameTimes[currentPos] = frameTimeMs;
+    currentPos = (currentPos + 1) % bufferSize;
+    numValid = std::min(numValid + 1, bufferSize);
+}
+
 double FpsCounter::getFps() {
     lastUpdate = std::chrono::high_resolution_clock::now();
-    auto time = timestamps[currentPos] - timestamps[(currentPos + 1) % bufferSize];
-    return static_cast<double>(bufferSize - 1) / std::chrono::duration<double>(time).count();
+    const double sum = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0);
+    if (numValid == 0 || sum <= 0.0) {
+        return 0.0;
+    }
+    return static_cast<double>(numValid) * 1000.0 / sum;
 }
 
 std::string FpsCounter::getFpsString() {
     const auto fps = getFps();
-    const double ms = 1000.0 / fps;
+    const double ms = fps > 0.0 ? 1000.0 / fps : 0.0;
     std::stringstream s;
     s << std::fixed << std::setprecision(2) << fps << " FPS / " << ms << " ms";
     return s.str();
 }
+
+FrameStatistics FpsCounter::getStatistics() const {
+    // Ring buffer order does not matter for the distribution, only use valid entries.
+    std::vector<double> times(frameTimes.begin(), frameTimes.begin() + static_cast<std::ptrdiff_t>(numValid));
+    return computeStatistics(std::move(times), stutterThresholdMs, histogramNumBins, histogramRangeMs);
+}
+
+void FpsCounter::setWindowSize(std::size_t size) {
+    if (size == 0) {
+        throw std::invalid_argument("FpsCounter window size must not be zero!");
+    }
+    bufferSize = size;
+    frameTimes = std::vector<double>(bufferSize, 0.0);
+    currentPos = 0;
+    numValid = 0;
+}
+
+void FpsCounter::setHistogram(std::size_t numBins, double rangeMs) {
+    histogramNumBins = std::max<std::size_t>(numBins, 1);
+    histogramRangeMs = rangeMs;
+}
+
+FrameStatistics FpsCounter::computeStatistics(std::vector<double> frameTimesMs, double stutterThresholdMs,
+    std::size_t numBins, double histogramRangeMs) {
+    FrameStatistics stats;
+    if (frameTimesMs.empty()) {
+        return stats;
+    }
+    std::sort(frameTimesMs.begin(), frameTimesMs.end());
+    const std::size_t n = frameTimesMs.size();
+
+    // Nearest-rank percentile on the sorted times.
+    auto percentile = [&](double p) {
+        const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(n)));
+        return frameTimesMs[std::clamp<std::size_t>(rank, 1, n) - 1];
+    };
+
+    stats.numFrames = n;
+    stats.minMs = frameTimesMs.front();
+    stats.maxMs = frameTimesMs.back();
+    stats.meanMs = std::accumulate(frameTimesMs.begin(), frameTimesMs.end(), 0.0) / static_cast<double>(n);
+    stats.p50Ms = percentile(50.0);
+    stats.p95Ms = percentile(95.0);
+    stats.p99Ms = percentile(99.0);
+
+    stats.stutterThresholdMs = stutterThresholdMs > 0.0 ? stutterThresholdMs : 2.0 * stats.p50Ms;
+    // Times are sorted, count all above the threshold.
+    stats.numStutters = static_cast<std::size_t>(frameTimesMs.end() -
+        std::upper_bound(frameTimesMs.begin(), frameTimesMs.end(), stats.stutterThresholdMs));
+
+    numBins = std::max<std::size_t>(numBins, 1);
+    const double range = histogramRangeMs > 0.0 ? histogramRangeMs : stats.maxMs;
+    stats.histogramBinWidthMs = range > 0.0 ? range / static_cast<double>(numBins) : 1.0;
+    stats.histogram.assign(numBins, 0);
+    for (const auto& t : frameTimesMs) {
+        const auto bin = static_cast<std::size_t>(std::max(0.0, t / stats.histogramBinWidthMs));
+        stats.histogram[std::min(bin, numBins - 1)]++;
+    }
+    return stats;
+}
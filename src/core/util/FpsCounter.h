@@ -6,6 +6,23 @@
 #include <vector>
 
 namespace OGL4Core2::Core {
+    /**
+     * Frame time distribution of a window of frames. All times are in milliseconds.
+     */
+    struct FrameStatistics {
+        std::size_t numFrames = 0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        double meanMs = 0.0;
+        double p50Ms = 0.0;
+        double p95Ms = 0.0;
+        double p99Ms = 0.0;
+        double stutterThresholdMs = 0.0;    //!< threshold used for counting stutters
+        std::size_t numStutters = 0;        //!< number of frames above the stutter threshold
+        double histogramBinWidthMs = 0.0;   //!< width of each histogram bin, first bin starts at 0 ms
+        std::vector<std::size_t> histogram; //!< frame count per bin, the last bin also counts all larger times
+    };
+
     class FpsCounter {
     public:
         explicit FpsCounter(double updateFrequency = 1.0, std::size_t bufferSize = 30);
@@ -13,15 +30,53 @@ namespace OGL4Core2::Core {
 
         bool tick();
 
+        /**
+         * Add an externally measured frame time, e.g. a GPU time, instead of measuring the time between ticks.
+         * @param frameTimeMs frame time in milliseconds
+         */
+        void addFrameTime(double frameTimeMs);
+
         double getFps();
 
         std::string getFpsString();
 
+        [[nodiscard]] FrameStatistics getStatistics() const;
+
+        /**
+         * Set the number of frames used for FPS and statistics. Clears the recorded frames.
+         */
+        void setWindowSize(std::size_t size);
+        [[nodiscard]] std::size_t getWindowSize() const {
+            return bufferSize;
+        }
+
+        /**
+         * Frames above this time count as stutter. A value <= 0 uses a relative threshold of twice the median.
+         */
+        void setStutterThreshold(double thresholdMs) {
+            stutterThresholdMs = thresholdMs;
+        }
+
+        /**
+         * Configure the histogram. A range <= 0 uses the maximum frame time of the window as range.
+         */
+        void setHistogram(std::size_t numBins, double rangeMs = 0.0);
+
+        [[nodiscard]] static FrameStatistics computeStatistics(std::vector<double> frameTimesMs,
+            double stutterThresholdMs = 0.0, std::size_t numBins = 32, double histogramRangeMs = 0.0);
+
     private:
         double updateFrequency;
         std::size_t bufferSize;
         std::chrono::high_resolution_clock::time_point lastUpdate;
+        std::chrono::high_resolution_clock::time_point lastTick;
         std::size_t currentPos;
-        std::vector<std::chrono::high_resolution_clock::time_point> timestamps;
+        std::size_t numValid;
+        bool started; //!< tick() was called before, lastTick is valid
+        std::vector<double> frameTimes;
+
+        double stutterThresholdMs;
+        std::size_t histogramNumBins;
+        double histogramRangeMs;
     };
 } // namespace OGL4Core2::Core
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace OGL4Core2::Core {
+    /**
+     * Read-only memory-mapped view of a file. The mapping is released when the object is destroyed, therefore any
+     * pointer into the data must not outlive it. The interface follows std::span, so the content can be parsed or
+     * uploaded directly from the page cache without copying it into a buffer first.
+     */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        [[nodiscard]] const unsigned char* data() const {
+            return data_;
+        }
+        [[nodiscard]] std::size_t size() const {
+            return size_;
+        }
+        [[nodiscard]] bool empty() const {
+            return size_ == 0;
+        }
+        [[nodiscard]] const unsigned char* begin() const {
+            return data_;
+        }
+        [[nodiscard]] const unsigned char* end() const {
+            return data_ + size_;
+        }
+        [[nodiscard]] const unsigned char& operator[](std::size_t i) const {
+            return data_[i];
+        }
+        [[nodiscard]] std::string_view str() const {
+            return {reinterpret_cast<const char*>(data_), size_};
+        }
+
+    private:
+        void release();
+
+        const unsigned char* data_ = nullptr;
+        std::size_t size_ = 0;
+#ifdef _WIN32
+        void* fileHandle_ = nullptr;
+        void* mappingHandle_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+    };
+} // namespace OGL4Core2::Core
@@ -0,0 +1,239 @@
+#include "Profiler.h"
+
+#include <cfloat>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include <imgui.h>
+#include <imgui_stdlib.h>
+
+using namespace OGL4Core2::Core;
+
+static constexpr std::size_t queryBatchSize = 64;
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : enabled_(false),
+      inFrame_(false),
+      maxHistory_(300),
+      frameNumber_(0),
+      startTime_(Clock::now()),
+      currentFrame_(),
+      traceFilename_("trace.json") {}
+
+void Profiler::beginFrame() {
+    if (!enabled_) {
+        return;
+    }
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    currentFrame_ = Frame();
+    currentFrame_.number = frameNumber_++;
+    currentFrame_.cpuStart = now();
+    currentFrame_.gpuOffset = currentFrame_.cpuStart - static_cast<std::int64_t>(gpuNow);
+    openZones_.clear();
+    inFrame_ = true;
+}
+
+void Profiler::endFrame() {
+    if (!inFrame_) {
+        return;
+    }
+    // Close zones left open by exceptions or unbalanced calls.
+    while (!openZones_.empty()) {
+        endZone();
+    }
+    currentFrame_.cpuEnd = now();
+    inFrame_ = false;
+    pendingFrames_.emplace_back(std::move(currentFrame_));
+
+    while (pendingFrames_.size() > queryLatency) {
+        resolveFrame(pendingFrames_.front());
+        history_.emplace_back(std::move(pendingFrames_.front()));
+        pendingFrames_.pop_front();
+        if (history_.size() > maxHistory_) {
+            history_.pop_front();
+        }
+    }
+}
+
+void Profiler::beginZone(const char* name, bool gpu) {
+    if (!inFrame_) {
+        return;
+    }
+    Zone zone{name, static_cast<int>(openZones_.size()), gpu, now(), 0, 0, 0, 0, 0};
+    if (gpu) {
+        zone.queryStart = acquireQuery();
+        zone.queryEnd = acquireQuery();
+        glQueryCounter(zone.queryStart, GL_TIMESTAMP);
+    }
+    openZones_.push_back(currentFrame_.zones.size());
+    currentFrame_.zones.emplace_back(std::move(zone));
+}
+
+void Profiler::endZone() {
+    if (!inFrame_ || openZones_.empty()) {
+        return;
+    }
+    Zone& zone = currentFrame_.zones[openZones_.back()];
+    openZones_.pop_back();
+    if (zone.gpu) {
+        glQueryCounter(zone.queryEnd, GL_TIMESTAMP);
+    }
+    zone.cpuEnd = now();
+}
+
+void Profiler::setEnabled(bool enabled) {
+    if (enabled_ == enabled) {
+        return;
+    }
+    enabled_ = enabled;
+    if (!enabled_) {
+        // Zones of an open frame are still closed by the Core, but their queries are dropped together with all
+        // frames still waiting for GPU results.
+        inFrame_ = false;
+        openZones_.clear();
+        for (const auto& zone : currentFrame_.zones) {
+            if (zone.gpu) {
+                freeQueries_.push_back(zone.queryStart);
+                freeQueries_.push_back(zone.queryEnd);
+            }
+        }
+        currentFrame_ = Frame();
+        for (auto& frame : pendingFrames_) {
+            resolveFrame(frame);
+        }
+        pendingFrames_.clear();
+    }
+}
+
+void Profiler::drawGUI() {
+    if (!ImGui::CollapsingHeader("Profiler")) {
+        return;
+    }
+    bool enabled = enabled_;
+    if (ImGui::Checkbox("Enabled", &enabled)) {
+        setEnabled(enabled);
+    }
+    if (history_.empty()) {
+        ImGui::Text("No data.");
+        return;
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(history_.size());
+    for (const auto& frame : history_) {
+        frameTimes.push_back(static_cast<float>(frame.cpuEnd - frame.cpuStart) * 1.0e-6f);
+    }
+    ImGui::PlotLines("CPU [ms]", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr, 0.0f,
+        FLT_MAX, ImVec2(0.0f, 60.0f));
+
+    const Frame& frame = history_.back();
+    ImGui::Text("Frame %llu: %.3f ms", static_cast<unsigned long long>(frame.number),
+        static_cast<double>(frame.cpuEnd - frame.cpuStart) * 1.0e-6);
+    if (ImGui::BeginTable("ProfilerZones", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("CPU [ms]");
+        ImGui::TableSetupColumn("GPU [ms]");
+        ImGui::TableHeadersRow();
+        for (const auto& zone : frame.zones) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Indent(static_cast<float>(zone.depth) * 10.0f + 1.0f);
+            ImGui::TextUnformatted(zone.name.c_str());
+            ImGui::Unindent(static_cast<float>(zone.depth) * 10.0f + 1.0f);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", static_cast<double>(zone.cpuEnd - zone.cpuStart) * 1.0e-6);
+            ImGui::TableNextColumn();
+            if (zone.gpu) {
+                ImGui::Text("%.3f", static_cast<double>(zone.gpuEnd - zone.gpuStart) * 1.0e-6);
+            } else {
+                ImGui::TextUnformatted("-");
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::InputText("Trace file", &traceFilename_);
+    if (ImGui::Button("Save Chrome trace")) {
+        try {
+            writeChromeTrace(traceFilename_);
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+        }
+    }
+}
+
+void Profiler::writeChromeTrace(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write trace file \"" + path.string() + "\"!");
+    }
+    // Chrome trace event format, complete events ("ph": "X") with timestamps in microseconds. CPU zones are shown in
+    // thread 0, GPU zones in thread 1. Open with chrome://tracing or https://ui.perfetto.dev.
+    auto writeEvent = [&](const std::string& name, const char* cat, int tid, std::int64_t start, std::int64_t end) {
+        file << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+             << ",\"ts\":" << static_cast<double>(start) * 1.0e-3
+             << ",\"dur\":" << static_cast<double>(end - start) * 1.0e-3 << "}";
+    };
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},";
+    file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for (const auto& frame : history_) {
+        writeEvent("Frame " + std::to_string(frame.number), "frame", 0, frame.cpuStart, frame.cpuEnd);
+        for (const auto& zone : frame.zones) {
+            writeEvent(zone.name, "cpu", 0, zone.cpuStart, zone.cpuEnd);
+            if (zone.gpu) {
+                writeEvent(zone.name, "gpu", 1, zone.gpuStart, zone.gpuEnd);
+            }
+        }
+    }
+    file << "\n]}" << std::endl;
+}
+
+void Profiler::releaseGLResources() {
+    setEnabled(false);
+    if (!allQueries_.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(allQueries_.size()), allQueries_.data());
+    }
+    allQueries_.clear();
+    freeQueries_.clear();
+}
+
+std::int64_t Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime_).count();
+}
+
+GLuint Profiler::acquireQuery() {
+    if (freeQueries_.empty()) {
+        std::vector<GLuint> queries(queryBatchSize);
+        glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+        allQueries_.insert(allQueries_.end(), queries.begin(), queries.end());
+        freeQueries_.insert(freeQueries_.end(), queries.begin(), queries.end());
+    }
+    GLuint query = freeQueries_.back();
+    freeQueries_.pop_back();
+    return query;
+}
+
+void Profiler::resolveFrame(Frame& frame) {
+    for (auto& zone : frame.zones) {
+        if (!zone.gpu) {
+            continue;
+        }
+        GLint64 start = 0;
+        GLint64 end = 0;
+        glGetQueryObjecti64v(zone.queryStart, GL_QUERY_RESULT, &start);
+        glGetQueryObjecti64v(zone.queryEnd, GL_QUERY_RESULT, &end);
+        zone.gpuStart = static_cast<std::int64_t>(start) + frame.gpuOffset;
+        zone.gpuEnd = static_cast<std::int64_t>(end) + frame.gpuOffset;
+        freeQueries_.push_back(zone.queryStart);
+        freeQueries_.push_back(zone.queryEnd);
+    }
+}
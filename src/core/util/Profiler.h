@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Core {
+    /**
+     * Hierarchical frame profiler with CPU zones and GPU zones. GPU zones are measured with GL timestamp queries,
+     * which are read back a few frames later to not stall the pipeline. The Core opens and closes a frame around
+     * each draw call, plugins only need to place zones around interesting passes:
+     *
+     *   void MyPlugin::drawToFBO() {
+     *       Core::Profiler::GpuZone zone("MyPlugin::drawToFBO");
+     *       ...
+     *   }
+     *
+     * Zones are ignored while the profiler is disabled or outside a frame.
+     */
+    class Profiler {
+    public:
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct Zone {
+            std::string name;
+            int depth;
+            bool gpu;
+            std::int64_t cpuStart; //!< ns since profiler start
+            std::int64_t cpuEnd;   //!< ns since profiler start
+            std::int64_t gpuStart; //!< ns since profiler start, mapped from GL timestamp
+            std::int64_t gpuEnd;   //!< ns since profiler start, mapped from GL timestamp
+            GLuint queryStart;
+            GLuint queryEnd;
+        };
+
+        struct Frame {
+            std::uint64_t number;
+            std::int64_t cpuStart;
+            std::int64_t cpuEnd;
+            std::int64_t gpuOffset; //!< offset to map GL timestamps to profiler time
+            std::vector<Zone> zones;
+        };
+
+        class CpuZone {
+        public:
+            explicit CpuZone(const char* name) {
+                Profiler::instance().beginZone(name, false);
+            }
+            ~CpuZone() {
+                Profiler::instance().endZone();
+            }
+            CpuZone(const CpuZone&) = delete;
+            CpuZone& operator=(const CpuZone&) = delete;
+        };
+
+        class GpuZone {
+        public:
+            explicit GpuZone(const char* name) {
+                Profiler::instance().beginZone(name, true);
+            }
+            ~GpuZone() {
+                Profiler::instance().endZone();
+            }
+            GpuZone(const GpuZone&) = delete;
+            GpuZone& operator=(const GpuZone&) = delete;
+        };
+
+        static Profiler& instance();
+
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        void beginFrame();
+        void endFrame();
+
+        void beginZone(const char* name, bool gpu);
+        void endZone();
+
+        [[nodiscard]] bool isEnabled() const {
+            return enabled_;
+        }
+        void setEnabled(bool enabled);
+
+        [[nodiscard]] const std::deque<Frame>& getHistory() const {
+            return history_;
+        }
+
+        void drawGUI();
+        void writeChromeTrace(const std::filesystem::path& path) const;
+
+        /**
+         * Delete all GL query objects. Must be called while the GL context is still current.
+         */
+        void releaseGLResources();
+
+    private:
+        Profiler();
+        ~Profiler() = default;
+
+        [[nodiscard]] std::int64_t now() const;
+        GLuint acquireQuery();
+        void resolveFrame(Frame& frame);
+
+        bool enabled_;
+        bool inFrame_;
+        std::size_t maxHistory_;
+        std::uint64_t frameNumber_;
+        Clock::time_point startTime_;
+
+        Frame currentFrame_;
+        std::vector<std::size_t> openZones_;
+        std::deque<Frame> pendingFrames_;
+        std::deque<Frame> history_;
+        std::vector<GLuint> freeQueries_;
+        std::vector<GLuint> allQueries_;
+
+        std::string traceFilename_;
+
+        static constexpr std::size_t queryLatency = 4;
+    };
+} // namespace OGL4Core2::Core
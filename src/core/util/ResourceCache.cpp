@@ -0,0 +1,129 @@
+#include "ResourceCache.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <lodepng.h>
+
+using namespace OGL4Core2::Core;
+
+static constexpr std::size_t defaultBudget = std::size_t(256) << 20u;
+
+ResourceCache& ResourceCache::instance() {
+    static ResourceCache cache;
+    return cache;
+}
+
+ResourceCache::ResourceCache() : budget_(defaultBudget), size_(0), hits_(0), misses_(0) {}
+
+std::shared_ptr<const std::string> ResourceCache::getFile(const std::filesystem::path& path) {
+    return get<std::string>("file:", path, [](const std::filesystem::path& p, std::size_t& size) {
+        std::ifstream file(p, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot read resource file \"" + p.string() + "\"!");
+        }
+        auto content = std::make_shared<std::string>();
+        file.seekg(0, std::ios::end);
+        content->resize(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(content->data(), static_cast<std::streamsize>(content->size()));
+        size = content->size();
+        return content;
+    });
+}
+
+std::shared_ptr<const ResourceCache::Image> ResourceCache::getPng(const std::filesystem::path& path) {
+    return get<Image>("png:", path, [](const std::filesystem::path& p, std::size_t& size) {
+        auto image = std::make_shared<Image>();
+        unsigned int w, h;
+        unsigned int error = lodepng::decode(image->data, w, h, p.string());
+        if (error != 0) {
+            std::string errorText = lodepng_error_text(error);
+            throw std::runtime_error("Cannot load PNG resource: " + errorText);
+        }
+        image->width = static_cast<int>(w);
+        image->height = static_cast<int>(h);
+        size = image->data.size();
+        return image;
+    });
+}
+
+template<typename T, typename Loader>
+std::shared_ptr<const T> ResourceCache::get(const std::string& kind, const std::filesystem::path& path,
+    Loader loader) {
+    const std::string key = kind + path.string();
+    const auto mtime = std::filesystem::last_write_time(path);
+    const auto fileSize = std::filesystem::file_size(path);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            if (it->second->mtime == mtime && it->second->fileSize == fileSize) {
+                hits_++;
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return std::static_pointer_cast<const T>(it->second->data);
+            }
+            // File changed, drop outdated entry.
+            size_ -= it->second->size;
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        misses_++;
+    }
+
+    // Load without holding the lock, so other resources can be served meanwhile.
+    std::size_t size = 0;
+    std::shared_ptr<const T> data = loader(path, size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size <= budget_ && index_.find(key) == index_.end()) {
+        entries_.push_front({key, mtime, fileSize, size, data});
+        index_[key] = entries_.begin();
+        size_ += size;
+        evict();
+    }
+    return data;
+}
+
+void ResourceCache::setBudget(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evict();
+}
+
+std::size_t ResourceCache::getBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+std::size_t ResourceCache::getSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+std::size_t ResourceCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::size_t ResourceCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void ResourceCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    size_ = 0;
+}
+
+void ResourceCache::evict() {
+    // Mutex must be held by caller.
+    while (size_ > budget_ && !entries_.empty()) {
+        size_ -= entries_.back().size;
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OGL4Core2::Core {
+    /**
+     * Process-wide cache for file contents and decoded PNG images, keyed by path. Entries are validated against the
+     * modification time and size of the file on every access, so edited files (e.g. shaders reloaded with F5) are
+     * read again. The least recently used entries are evicted when the memory budget is exceeded. Thread-safe.
+     */
+    class ResourceCache {
+    public:
+        struct Image {
+            std::vector<unsigned char> data; //!< RGBA8
+            int width;
+            int height;
+        };
+
+        static ResourceCache& instance();
+
+        ResourceCache(const ResourceCache&) = delete;
+        ResourceCache& operator=(const ResourceCache&) = delete;
+
+        [[nodiscard]] std::shared_ptr<const std::string> getFile(const std::filesystem::path& path);
+        [[nodiscard]] std::shared_ptr<const Image> getPng(const std::filesystem::path& path);
+
+        void setBudget(std::size_t bytes);
+        [[nodiscard]] std::size_t getBudget() const;
+        [[nodiscard]] std::size_t getSize() const;
+        [[nodiscard]] std::size_t getHits() const;
+        [[nodiscard]] std::size_t getMisses() const;
+
+        void clear();
+
+    private:
+        struct Entry {
+            std::string key;
+            std::filesystem::file_time_type mtime;
+            std::uintmax_t fileSize;
+            std::size_t size;
+            std::shared_ptr<const void> data;
+        };
+        using EntryList = std::list<Entry>;
+
+        ResourceCache();
+        ~ResourceCache() = default;
+
+        template<typename T, typename Loader>
+        std::shared_ptr<const T> get(const std::string& kind, const std::filesystem::path& path, Loader loader);
+
+        void evict();
+
+        EntryList entries_; //!< front is most recently used
+        std::unordered_map<std::string, EntryList::iterator> index_;
+        std::size_t budget_;
+        std::size_t size_;
+        std::size_t hits_;
+        std::size_t misses_;
+        mutable std::mutex mutex_;
+    };
+} // namespace OGL4Core2::Core
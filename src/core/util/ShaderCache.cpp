@@ -0,0 +1,170 @@
+#include "ShaderCache.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#include "FileUtil.h"
+
+using namespace OGL4Core2::Core;
+
+static constexpr std::uint32_t cacheFileMagic = 0x4250474fu; // "OGPB"
+static constexpr char stubVertexShader[] = "#version 330 core\nvoid main() {}\n";
+
+// FNV-1a, stable across platforms and runs in contrast to std::hash.
+static void hashBytes(std::uint64_t& hash, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+static void hashString(std::uint64_t& hash, const std::string& str) {
+    const std::uint64_t size = str.size();
+    hashBytes(hash, &size, sizeof(size));
+    hashBytes(hash, str.data(), str.size());
+}
+
+static std::string glString(GLenum name) {
+    const auto* str = reinterpret_cast<const char*>(glGetString(name));
+    return str != nullptr ? std::string(str) : std::string();
+}
+
+ShaderCache& ShaderCache::instance() {
+    static ShaderCache cache;
+    return cache;
+}
+
+ShaderCache::ShaderCache() : enabled_(true), hits_(0), misses_(0) {
+    try {
+        dir_ = FileUtil::getFullExeName().parent_path() / "shadercache";
+    } catch (const std::exception&) {
+        dir_ = std::filesystem::temp_directory_path() / "ogl4core2-shadercache";
+    }
+}
+
+std::unique_ptr<glowl::GLSLProgram> ShaderCache::createProgram(
+    const glowl::GLSLProgram::ShaderSourceList& shaderList) {
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (!enabled_ || numFormats <= 0) {
+        return std::make_unique<glowl::GLSLProgram>(shaderList);
+    }
+
+    std::ostringstream fileName;
+    fileName << std::hex << std::setw(16) << std::setfill('0') << computeKey(shaderList) << ".bin";
+    const std::filesystem::path file = dir_ / fileName.str();
+
+    auto program = loadProgram(file);
+    if (program != nullptr) {
+        hits_++;
+        return program;
+    }
+    misses_++;
+    program = std::make_unique<glowl::GLSLProgram>(shaderList);
+    // Some drivers only keep a retrievable binary if the hint was set before linking. glowl links in its
+    // constructor, so the program is linked again with the hint. The shaders stay attached after linking.
+    GLint numShaders = 0;
+    glGetProgramiv(program->getHandle(), GL_ATTACHED_SHADERS, &numShaders);
+    if (numShaders > 0) {
+        glProgramParameteri(program->getHandle(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program->getHandle());
+        GLint linkStatus = GL_FALSE;
+        glGetProgramiv(program->getHandle(), GL_LINK_STATUS, &linkStatus);
+        if (linkStatus != GL_TRUE) {
+            // Cannot happen for sources which linked before, but never hand out a broken program.
+            return std::make_unique<glowl::GLSLProgram>(shaderList);
+        }
+    }
+    storeProgram(file, *program);
+    return program;
+}
+
+void ShaderCache::clear() {
+    std::error_code ec;
+    std::filesystem::remove_all(dir_, ec);
+    if (ec) {
+        std::cerr << "Cannot clear shader cache \"" << dir_.string() << "\": " << ec.message() << std::endl;
+    }
+}
+
+std::uint64_t ShaderCache::computeKey(const glowl::GLSLProgram::ShaderSourceList& shaderList) const {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    // Binaries are only valid for the driver which created them.
+    hashString(hash, glString(GL_VENDOR));
+    hashString(hash, glString(GL_RENDERER));
+    hashString(hash, glString(GL_VERSION));
+    for (const auto& [type, source] : shaderList) {
+        const auto t = static_cast<std::uint32_t>(type);
+        hashBytes(hash, &t, sizeof(t));
+        hashString(hash, source);
+    }
+    return hash;
+}
+
+std::unique_ptr<glowl::GLSLProgram> ShaderCache::loadProgram(const std::filesystem::path& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        return nullptr;
+    }
+    std::uint32_t magic = 0;
+    GLenum format = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!in || magic != cacheFileMagic) {
+        return nullptr;
+    }
+    std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (binary.empty()) {
+        return nullptr;
+    }
+
+    // glowl can only create programs from source, therefore the binary replaces a minimal stub program. Uniform
+    // locations are queried by name on use, so the program behaves exactly like a compiled one.
+    auto program = std::make_unique<glowl::GLSLProgram>(
+        glowl::GLSLProgram::ShaderSourceList{{glowl::GLSLProgram::ShaderType::Vertex, stubVertexShader}});
+    glProgramBinary(program->getHandle(), format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(program->getHandle(), GL_LINK_STATUS, &linkStatus);
+    if (linkStatus != GL_TRUE) {
+        // Driver rejected the binary, e.g. after a driver update with unchanged version strings.
+        return nullptr;
+    }
+    return program;
+}
+
+void ShaderCache::storeProgram(const std::filesystem::path& file, const glowl::GLSLProgram& program) {
+    GLint length = 0;
+    glGetProgramiv(program.getHandle(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(static_cast<std::size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program.getHandle(), length, nullptr, &format, binary.data());
+
+    // Write to a temporary file first, so concurrent instances never read a partially written binary.
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    std::filesystem::path tmpFile = file;
+    tmpFile += ".tmp";
+    {
+        std::ofstream out(tmpFile, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Cannot write shader cache file \"" << tmpFile.string() << "\"!" << std::endl;
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&cacheFileMagic), sizeof(cacheFileMagic));
+        out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    }
+    std::filesystem::rename(tmpFile, file, ec);
+    if (ec) {
+        std::filesystem::remove(tmpFile, ec);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <glad/gl.h>
+#include <glowl/glowl.h>
+
+namespace OGL4Core2::Core {
+    /**
+     * Persistent cache for linked shader programs. Program binaries are stored on disk, keyed by a hash of the shader
+     * sources and the GL vendor, renderer and version strings. On a hit the binary is loaded with glProgramBinary()
+     * instead of compiling the sources, on a miss (or if the driver rejects the binary) the program is compiled as
+     * usual and the binary is written to the cache. Replace
+     *
+     *   shader = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{...});
+     *
+     * with
+     *
+     *   shader = Core::ShaderCache::instance().createProgram(glowl::GLSLProgram::ShaderSourceList{...});
+     *
+     * Compile errors are thrown as glowl::GLSLProgramException like before. Must be used on the render thread.
+     */
+    class ShaderCache {
+    public:
+        static ShaderCache& instance();
+
+        ShaderCache(const ShaderCache&) = delete;
+        ShaderCache& operator=(const ShaderCache&) = delete;
+
+        [[nodiscard]] std::unique_ptr<glowl::GLSLProgram> createProgram(
+            const glowl::GLSLProgram::ShaderSourceList& shaderList);
+
+        void setEnabled(bool enabled) {
+            enabled_ = enabled;
+        }
+        [[nodiscard]] bool isEnabled() const {
+            return enabled_;
+        }
+
+        void setDirectory(const std::filesystem::path& dir) {
+            dir_ = dir;
+        }
+        [[nodiscard]] const std::filesystem::path& getDirectory() const {
+            return dir_;
+        }
+
+        [[nodiscard]] std::size_t getHits() const {
+            return hits_;
+        }
+        [[nodiscard]] std::size_t getMisses() const {
+            return misses_;
+        }
+
+        /**
+         * Delete all cached program binaries from disk.
+         */
+        void clear();
+
+    private:
+        ShaderCache();
+        ~ShaderCache() = default;
+
+        std::uint64_t computeKey(const glowl::GLSLProgram::ShaderSourceList& shaderList) const;
+        std::unique_ptr<glowl::GLSLProgram> loadProgram(const std::filesystem::path& file);
+        void storeProgram(const std::filesystem::path& file, const glowl::GLSLProgram& program);
+
+        std::filesystem::path dir_;
+        bool enabled_;
+        std::size_t hits_;
+        std::size_t misses_;
+    };
+} // namespace OGL4Core2::Core
@@ -1,11 +1,56 @@
 #include <exception>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
 
 #include "core/Core.h"
 
-int main() {
+static void printUsage() {
+    std::cout << "Usage: OGL4Core2 [--headless <plugin name> [--frames <n>] [--warmup <n>] [--size <width> <height>]"
+                 " [--report <file>] [--trace <file>]]"
+              << std::endl;
+}
+
+static std::optional<OGL4Core2::Core::HeadlessOptions> parseArgs(int argc, char** argv) {
+    bool headless = false;
+    OGL4Core2::Core::HeadlessOptions options;
+    auto next = [&](int& i) -> std::string {
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for argument \"" + std::string(argv[i]) + "\"!");
+        }
+        return argv[++i];
+    };
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.pluginName = next(i);
+            headless = true;
+        } else if (arg == "--frames") {
+            options.numFrames = std::stoi(next(i));
+        } else if (arg == "--warmup") {
+            options.numWarmupFrames = std::stoi(next(i));
+        } else if (arg == "--size") {
+            options.width = std::stoi(next(i));
+            options.height = std::stoi(next(i));
+        } else if (arg == "--report") {
+            options.reportPath = next(i);
+        } else if (arg == "--trace") {
+            options.tracePath = next(i);
+        } else {
+            printUsage();
+            throw std::runtime_error("Unknown argument \"" + arg + "\"!");
+        }
+    }
+    if (!headless) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+int main(int argc, char** argv) {
     try {
-        OGL4Core2::Core::Core c;
+        OGL4Core2::Core::Core c(parseArgs(argc, argv));
         c.run();
     } catch (const std::exception& ex) {
         std::cerr << "OGL4Core2 Exception: " << ex.what() << std::endl;
@@ -10,6 +10,7 @@
 #include <imgui.h>
 
 #include "core/Core.h"
+#include "core/util/Profiler.h"
 #include <glm/gtx/string_cast.hpp>
 using namespace OGL4Core2;
 using namespace OGL4Core2::Plugins::PCVC::PathTracing;
@@ -570,17 +571,17 @@ void PathTracing::mouseMove(double xpos, double ypos) {
  */
 void PathTracing::initShaders() {
     try {
-        shaderQuad = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/quad.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/quad.frag")}});
+        createShaderProgram(shaderQuad, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/quad.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/quad.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     try {
-        shaderPathTracer = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/pathTracer.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/pathTracer.frag")}});
+        createShaderProgram(shaderPathTracer, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/pathTracer.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/pathTracer.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -730,6 +731,7 @@ void PathTracing::updateMatrices() {
  * @brief Draw to framebuffer object.
  */
 void PathTracing::drawToFBO() {
+    Core::Profiler::GpuZone profilerZone("PathTracing::drawToFBO");
     if (!glIsFramebuffer(fbo)) {
         return;
     }
@@ -111,9 +111,9 @@ void Base::reloadShaders() {
  */
 void Base::initShaders() {
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/base.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/base.frag")}});
+        basePlugin.createShaderProgram(shaderProgram, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/base.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/base.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -151,10 +151,10 @@ void Cube::initShaders() {
     //  TODO: Init cube shader program!
     // --------------------------------------------------------------------------------
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/cube.vert")},
-            {glowl::GLSLProgram::ShaderType::Geometry, basePlugin.getStringResource("shaders/cube.geom")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/cube.frag")} });
+        basePlugin.createShaderProgram(shaderProgram, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/cube.vert"},
+            {glowl::GLSLProgram::ShaderType::Geometry, "shaders/cube.geom"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/cube.frag"} });
     }
     catch (glowl::GLSLProgramException& e) { std::cerr << e.what() << std::endl; }
 }
@@ -227,9 +227,9 @@ void Sphere::initShaders() {
     //  TODO: Init sphere shader program!
     // --------------------------------------------------------------------------------
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/sphere.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/sphere.frag")} });
+        basePlugin.createShaderProgram(shaderProgram, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/sphere.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/sphere.frag"} });
     }
     catch (glowl::GLSLProgramException& e) { std::cerr << e.what() << std::endl; }
 }
@@ -331,9 +331,9 @@ void Torus::initShaders() {
     //  TODO: Init torus shader program!
     // --------------------------------------------------------------------------------
     try {
-        shaderProgram = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, basePlugin.getStringResource("shaders/torus.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, basePlugin.getStringResource("shaders/torus.frag")} });
+        basePlugin.createShaderProgram(shaderProgram, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/torus.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/torus.frag"} });
     }
     catch (glowl::GLSLProgramException& e) { std::cerr << e.what() << std::endl; }
 }
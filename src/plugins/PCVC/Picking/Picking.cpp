@@ -10,6 +10,7 @@
 
 #include "Objects.h"
 #include "core/Core.h"
+#include "core/util/Profiler.h"
 #include <glm/gtx/string_cast.hpp>
 using namespace OGL4Core2;
 using namespace OGL4Core2::Plugins::PCVC::Picking;
@@ -67,9 +68,10 @@ Picking::Picking(const Core::Core& c)
     //  TODO: Load textures from the "resources/textures" folder.
     //        Use the "getTextureResource" helper function.
     // --------------------------------------------------------------------------------
-    texBoard = getTextureResource("textures/board.png");
-    texDice = getTextureResource("textures/dice.png");
-    texEarth = getTextureResource("textures/earth.png");
+    auto textures = getTextureResources({"textures/board.png", "textures/dice.png", "textures/earth.png"});
+    texBoard = textures[0];
+    texDice = textures[1];
+    texEarth = textures[2];
 
     // --------------------------------------------------------------------------------
     //  TODO: Setup the 3D scene. Add a dice, a sphere, and a torus.
@@ -353,9 +355,9 @@ void Picking::mouseMove(double xpos, double ypos) {
  */
 void Picking::initShaders() {
     try {
-        shaderQuad = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/quad.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/quad.frag")}});
+        createShaderProgram(shaderQuad, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/quad.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/quad.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -364,9 +366,9 @@ void Picking::initShaders() {
     //  TODO: Init box shader.
     // --------------------------------------------------------------------------------
     try {
-        shaderBox = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/box.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/box.frag")} });
+        createShaderProgram(shaderBox, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/box.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/box.frag"} });
     }
     catch (glowl::GLSLProgramException& e) { std::cerr << e.what() << std::endl; }
 }
@@ -571,6 +573,7 @@ void Picking::updateMatrices() {
  * @brief Draw to framebuffer object.
  */
 void Picking::drawToFBO() {
+    Core::Profiler::GpuZone profilerZone("Picking::drawToFBO");
     if (!glIsFramebuffer(fbo)) {
         return;
     }
@@ -610,6 +613,7 @@ void Picking::drawToFBO() {
  * @brief Draw view of spot light into corresponding FBO.
  */
 void Picking::drawToLightFBO() {
+    Core::Profiler::GpuZone profilerZone("Picking::drawToLightFBO");
     if (!glIsFramebuffer(lightFbo)) {
         return;
     }
@@ -1,6 +1,8 @@
 #include "SurfaceVis.h"
 
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -13,6 +15,7 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "core/Core.h"
+#include "core/util/Profiler.h"
 
 const int IDX_OFFSET = 10;
 
@@ -385,27 +388,27 @@ unsigned int SurfaceVis::colorToId(const unsigned char col[3]) {
 void SurfaceVis::initShaders() {
     // Initialize shader for rendering fbo content
     try {
-        shaderQuad = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/quad.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/quad.frag")}});
+        createShaderProgram(shaderQuad, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/quad.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/quad.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for box rendering
     try {
-        shaderBox = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/box.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/box.frag")}});
+        createShaderProgram(shaderBox, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/box.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/box.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for control point rendering
     try {
-        shaderControlPoints = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/control-points.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/control-points.frag")}});
+        createShaderProgram(shaderControlPoints, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/control-points.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/control-points.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -415,11 +418,11 @@ void SurfaceVis::initShaders() {
     //  TODO: Implement shader creation for the B-Spline surface shader.
     // --------------------------------------------------------------------------------
     try {
-        shaderBSplineSurface = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/surface.vert")},
-            {glowl::GLSLProgram::ShaderType::TessControl, getStringResource("shaders/surface.tesc")},
-            {glowl::GLSLProgram::ShaderType::TessEvaluation, getStringResource("shaders/surface.tese")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/surface.frag")} });
+        createShaderProgram(shaderBSplineSurface, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/surface.vert"},
+            {glowl::GLSLProgram::ShaderType::TessControl, "shaders/surface.tesc"},
+            {glowl::GLSLProgram::ShaderType::TessEvaluation, "shaders/surface.tese"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/surface.frag"} });
     }
     catch (glowl::GLSLProgramException& e) { std::cerr << e.what() << std::endl; }
 }
@@ -646,6 +649,7 @@ void SurfaceVis::initKnotVectors() {
  * @brief Draw to framebuffer object.
  */
 void SurfaceVis::drawToFBO() {
+    Core::Profiler::GpuZone profilerZone("SurfaceVis::drawToFBO");
     // --------------------------------------------------------------------------------
     //  TODO: Render to the fbo.
     //        - Draw the box if the variable 'showBox' is true
@@ -732,20 +736,39 @@ void SurfaceVis::loadControlPoints(const std::string& filename) {
     // --------------------------------------------------------------------------------
     //  TODO: Load the control points file from 'path' and initialize all related data.
     // --------------------------------------------------------------------------------
-    std::ifstream file(path);
-    if (!file.good()) {
+    Core::MappedFile file;
+    try {
+        file = Core::MappedFile(path);
+    } catch (const std::exception&) {
         std::cout << "file doesn't exist!" << std::endl;
         return;
     }
-    file >> numControlPoints_n >> degree_p >> numControlPoints_m >> degree_q;
+
+    // Parse in place from the mapped file.
+    const char* ptr = file.str().data();
+    const char* end = ptr + file.size();
+    auto skipSpace = [&ptr, end]() {
+        while (ptr < end && std::isspace(static_cast<unsigned char>(*ptr))) {
+            ptr++;
+        }
+    };
+    for (int* value : {&numControlPoints_n, &degree_p, &numControlPoints_m, &degree_q}) {
+        skipSpace();
+        ptr = std::from_chars(ptr, end, *value).ptr;
+    }
 
     // Load vertex
     float coord;
     controlPointsVertices.clear();
-    while (file >> coord) {
+    while (true) {
+        skipSpace();
+        auto [next, ec] = std::from_chars(ptr, end, coord);
+        if (ec != std::errc()) {
+            break;
+        }
         controlPointsVertices.push_back(coord);
+        ptr = next;
     }
-    file.close();
 
     // Init. index and idColor
     std::vector<GLuint> controlPointsIndices;
@@ -0,0 +1,79 @@
+#include "BrickCache.h"
+
+#include <utility>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+BrickCache::BrickCache(std::shared_ptr<const BrickedVolume> volume, std::size_t budget)
+    : volume_(std::move(volume)),
+      budget_(budget),
+      size_(0),
+      hits_(0),
+      misses_(0) {}
+
+BrickCache::Brick BrickCache::get(std::size_t brick, unsigned int level) {
+    // The brick order of the file is unique over all levels.
+    const std::size_t key = volume_->firstBrick(level) + brick;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            hits_++;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->data;
+        }
+        misses_++;
+    }
+
+    // Decode without holding the lock, so other bricks can be served meanwhile.
+    Brick data = std::make_shared<const std::vector<std::uint8_t>>(volume_->readBrick(brick, level));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        // Decoded by another thread meanwhile.
+        return it->second->data;
+    }
+    if (data->size() <= budget_) {
+        entries_.push_front({key, data});
+        index_[key] = entries_.begin();
+        size_ += data->size();
+        evict();
+    }
+    return data;
+}
+
+void BrickCache::setBudget(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evict();
+}
+
+std::size_t BrickCache::getBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+std::size_t BrickCache::getSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+std::size_t BrickCache::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::size_t BrickCache::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void BrickCache::evict() {
+    // Mutex must be held by caller.
+    while (size_ > budget_ && !entries_.empty()) {
+        size_ -= entries_.back().data->size();
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
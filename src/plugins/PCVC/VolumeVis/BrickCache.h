@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BrickedVolume.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Decoded bricks of a bricked volume, keyed by level and brick. Missing bricks are decoded on access. The least
+     * recently used bricks are evicted when the memory budget is exceeded, bricks still referenced by a caller stay
+     * alive until they are released. Thread-safe.
+     */
+    class BrickCache {
+    public:
+        using Brick = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+        BrickCache(std::shared_ptr<const BrickedVolume> volume, std::size_t budget);
+
+        BrickCache(const BrickCache&) = delete;
+        BrickCache& operator=(const BrickCache&) = delete;
+
+        /**
+         * Get a decoded brick, see BrickedVolume::readBrick().
+         */
+        [[nodiscard]] Brick get(std::size_t brick, unsigned int level);
+
+        void setBudget(std::size_t bytes);
+        [[nodiscard]] std::size_t getBudget() const;
+        [[nodiscard]] std::size_t getSize() const;
+        [[nodiscard]] std::size_t getHits() const;
+        [[nodiscard]] std::size_t getMisses() const;
+
+    private:
+        struct Entry {
+            std::size_t key;
+            Brick data;
+        };
+        using EntryList = std::list<Entry>;
+
+        void evict();
+
+        std::shared_ptr<const BrickedVolume> volume_;
+        EntryList entries_; //!< front is most recently used
+        std::unordered_map<std::size_t, EntryList::iterator> index_;
+        std::size_t budget_;
+        std::size_t size_;
+        std::size_t hits_;
+        std::size_t misses_;
+        mutable std::mutex mutex_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,85 @@
+#include "BrickGrid.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+// Voxel indices per brick along one axis, including the wrapped one voxel border.
+static std::vector<std::vector<unsigned int>> brickIndices(unsigned int volumeRes, unsigned int gridRes) {
+    std::vector<std::vector<unsigned int>> indices(gridRes);
+    const auto n = static_cast<long long>(volumeRes);
+    for (unsigned int b = 0; b < gridRes; b++) {
+        const long long first = static_cast<long long>(b) * BrickGrid::brickSize - 1;
+        const long long last = std::min(static_cast<long long>(b + 1) * BrickGrid::brickSize, n);
+        for (long long i = first; i <= last; i++) {
+            indices[b].push_back(static_cast<unsigned int>((i + n) % n));
+        }
+    }
+    return indices;
+}
+
+template<typename T>
+BrickGrid BrickGrid::build(const T* voxels, glm::uvec3 volumeRes, Histogram::ValueRange range,
+    unsigned int numThreads) {
+    BrickGrid grid;
+    if (voxels == nullptr || volumeRes.x == 0 || volumeRes.y == 0 || volumeRes.z == 0) {
+        return grid;
+    }
+    grid.res_ = (volumeRes + glm::uvec3(brickSize - 1)) / brickSize;
+    grid.ranges_.resize(static_cast<std::size_t>(grid.res_.x) * grid.res_.y * grid.res_.z);
+
+    const auto xIndices = brickIndices(volumeRes.x, grid.res_.x);
+    const auto yIndices = brickIndices(volumeRes.y, grid.res_.y);
+    const auto zIndices = brickIndices(volumeRes.z, grid.res_.z);
+    const float offset = range.min;
+    const float scale = range.max > range.min ? 1.0f / (range.max - range.min) : 1.0f;
+
+    // Each thread takes every numThreads-th slab of bricks.
+    auto buildSlabs = [&](unsigned int firstSlab, unsigned int slabStep) {
+        for (unsigned int bz = firstSlab; bz < grid.res_.z; bz += slabStep) {
+            for (unsigned int by = 0; by < grid.res_.y; by++) {
+                for (unsigned int bx = 0; bx < grid.res_.x; bx++) {
+                    T minValue = std::numeric_limits<T>::max();
+                    T maxValue = std::numeric_limits<T>::lowest();
+                    for (unsigned int z : zIndices[bz]) {
+                        for (unsigned int y : yIndices[by]) {
+                            const T* row = voxels + (static_cast<std::size_t>(z) * volumeRes.y + y) * volumeRes.x;
+                            for (unsigned int x : xIndices[bx]) {
+                                minValue = std::min(minValue, row[x]);
+                                maxValue = std::max(maxValue, row[x]);
+                            }
+                        }
+                    }
+                    // A brick without finite values (only NaN) keeps the full range and is never skipped.
+                    glm::vec2 brickRange(0.0f, 1.0f);
+                    if (minValue <= maxValue) {
+                        brickRange = glm::vec2((static_cast<float>(minValue) - offset) * scale,
+                            (static_cast<float>(maxValue) - offset) * scale);
+                    }
+                    grid.ranges_[(static_cast<std::size_t>(bz) * grid.res_.y + by) * grid.res_.x + bx] = brickRange;
+                }
+            }
+        }
+    };
+
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, grid.res_.z);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; t++) {
+        threads.emplace_back(buildSlabs, t, numThreads);
+    }
+    buildSlabs(0, numThreads);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return grid;
+}
+
+template BrickGrid BrickGrid::build(const std::uint8_t*, glm::uvec3, Histogram::ValueRange, unsigned int);
+template BrickGrid BrickGrid::build(const std::uint16_t*, glm::uvec3, Histogram::ValueRange, unsigned int);
+template BrickGrid BrickGrid::build(const float*, glm::uvec3, Histogram::ValueRange, unsigned int);
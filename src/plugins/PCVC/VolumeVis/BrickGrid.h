@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Histogram.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Min/max acceleration grid for empty-space skipping. The volume is divided into bricks of brickSize^3 voxels and
+     * the value range of each brick is stored, mapped to [0, 1] like the volume shader maps the texture values.
+     *
+     * Each brick includes a one voxel border of its neighbors, so the range also covers every trilinear interpolation
+     * of samples inside the brick. The border wraps around at the volume faces, like the GL_REPEAT volume texture.
+     */
+    class BrickGrid {
+    public:
+        static constexpr unsigned int brickSize = 16;
+
+        BrickGrid() : res_(0) {}
+
+        /**
+         * Grid from precomputed brick ranges, e.g. read from a cache.
+         */
+        BrickGrid(glm::uvec3 res, std::vector<glm::vec2> ranges) : res_(res), ranges_(std::move(ranges)) {}
+
+        /**
+         * Build the grid in parallel over slabs of bricks.
+         * @param voxels      The voxel values
+         * @param volumeRes   The volume resolution
+         * @param range       The value range which is mapped to [0, 1]
+         * @param numThreads  The number of threads, 0 uses the number of hardware threads
+         */
+        template<typename T>
+        static BrickGrid build(const T* voxels, glm::uvec3 volumeRes, Histogram::ValueRange range,
+            unsigned int numThreads = 0);
+
+        [[nodiscard]] const glm::uvec3& res() const {
+            return res_;
+        }
+
+        /**
+         * Normalized (min, max) per brick, x is the fastest running index.
+         */
+        [[nodiscard]] const std::vector<glm::vec2>& ranges() const {
+            return ranges_;
+        }
+
+    private:
+        glm::uvec3 res_;
+        std::vector<glm::vec2> ranges_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,381 @@
+#include "BrickedVolume.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <lodepng.h>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static constexpr char magic[8] = {'O', 'G', 'L', 'B', 'V', 'O', 'L', '\0'};
+static constexpr std::uint32_t formatVersion = 2;
+
+// Calls fn(i) for i in [0, count), the threads take indices from a shared counter.
+static void parallelFor(std::size_t count, unsigned int numThreads, const std::function<void(std::size_t)>& fn) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = static_cast<unsigned int>(std::min<std::size_t>(numThreads, std::max<std::size_t>(count, 1)));
+
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto run = [&]() {
+        try {
+            for (std::size_t i = next++; i < count; i = next++) {
+                fn(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            error = std::current_exception();
+            next = count;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; t++) {
+        threads.emplace_back(run);
+    }
+    run();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Brick origin and size for a grid of bricks.
+static void brickExtentOf(std::size_t brick, glm::uvec3 res, glm::uvec3 gridRes, unsigned int brickSize,
+    glm::uvec3& origin, glm::uvec3& size) {
+    const glm::uvec3 coord(static_cast<unsigned int>(brick % gridRes.x),
+        static_cast<unsigned int>((brick / gridRes.x) % gridRes.y),
+        static_cast<unsigned int>(brick / (static_cast<std::size_t>(gridRes.x) * gridRes.y)));
+    origin = coord * brickSize;
+    size = glm::min(res - origin, glm::uvec3(brickSize));
+}
+
+// Byte offset of the first voxel of a brick row in the volume.
+static std::size_t volumeRowOffset(glm::uvec3 res, glm::uvec3 origin, unsigned int y, unsigned int z,
+    std::size_t voxelBytes) {
+    return ((static_cast<std::size_t>(origin.z + z) * res.y + origin.y + y) * res.x + origin.x) * voxelBytes;
+}
+
+static void copyFromVolume(const std::uint8_t* volume, glm::uvec3 res, std::uint8_t* brickData, glm::uvec3 origin,
+    glm::uvec3 size, std::size_t voxelBytes) {
+    const std::size_t rowBytes = size.x * voxelBytes;
+    for (unsigned int z = 0; z < size.z; z++) {
+        for (unsigned int y = 0; y < size.y; y++) {
+            std::memcpy(brickData + (static_cast<std::size_t>(z) * size.y + y) * rowBytes,
+                volume + volumeRowOffset(res, origin, y, z, voxelBytes), rowBytes);
+        }
+    }
+}
+
+static void copyToVolume(std::uint8_t* volume, glm::uvec3 res, const std::uint8_t* brickData, glm::uvec3 origin,
+    glm::uvec3 size, std::size_t voxelBytes) {
+    const std::size_t rowBytes = size.x * voxelBytes;
+    for (unsigned int z = 0; z < size.z; z++) {
+        for (unsigned int y = 0; y < size.y; y++) {
+            std::memcpy(volume + volumeRowOffset(res, origin, y, z, voxelBytes),
+                brickData + (static_cast<std::size_t>(z) * size.y + y) * rowBytes, rowBytes);
+        }
+    }
+}
+
+// Split voxels into byte planes, which compress much better for 16 and 32 bit values.
+static std::vector<std::uint8_t> toBytePlanes(const std::vector<std::uint8_t>& voxels, std::size_t voxelBytes) {
+    if (voxelBytes == 1) {
+        return voxels;
+    }
+    const std::size_t numVoxels = voxels.size() / voxelBytes;
+    std::vector<std::uint8_t> planes(voxels.size());
+    for (std::size_t i = 0; i < numVoxels; i++) {
+        for (std::size_t b = 0; b < voxelBytes; b++) {
+            planes[b * numVoxels + i] = voxels[i * voxelBytes + b];
+        }
+    }
+    return planes;
+}
+
+static std::vector<std::uint8_t> fromBytePlanes(const std::vector<std::uint8_t>& planes, std::size_t voxelBytes) {
+    if (voxelBytes == 1) {
+        return planes;
+    }
+    const std::size_t numVoxels = planes.size() / voxelBytes;
+    std::vector<std::uint8_t> voxels(planes.size());
+    for (std::size_t i = 0; i < numVoxels; i++) {
+        for (std::size_t b = 0; b < voxelBytes; b++) {
+            voxels[i * voxelBytes + b] = planes[b * numVoxels + i];
+        }
+    }
+    return voxels;
+}
+
+// Halve the resolution with a 2x2x2 box filter, the last voxel is repeated at odd sizes.
+template<typename T>
+static std::vector<std::uint8_t> downsample(const std::uint8_t* volume, glm::uvec3 res,
+    glm::uvec3 halfRes, unsigned int numThreads) {
+    std::vector<std::uint8_t> result(static_cast<std::size_t>(halfRes.x) * halfRes.y * halfRes.z * sizeof(T));
+    const auto* src = reinterpret_cast<const T*>(volume);
+    auto* dst = reinterpret_cast<T*>(result.data());
+    parallelFor(halfRes.z, numThreads, [&](std::size_t z) {
+        const std::size_t z0 = 2 * z;
+        const std::size_t z1 = std::min<std::size_t>(z0 + 1, res.z - 1);
+        for (std::size_t y = 0; y < halfRes.y; y++) {
+            const std::size_t y0 = 2 * y;
+            const std::size_t y1 = std::min<std::size_t>(y0 + 1, res.y - 1);
+            for (std::size_t x = 0; x < halfRes.x; x++) {
+                const std::size_t x0 = 2 * x;
+                const std::size_t x1 = std::min<std::size_t>(x0 + 1, res.x - 1);
+                double sum = 0.0;
+                for (std::size_t zz : {z0, z1}) {
+                    for (std::size_t yy : {y0, y1}) {
+                        const T* row = src + (zz * res.y + yy) * res.x;
+                        sum += static_cast<double>(row[x0]) + static_cast<double>(row[x1]);
+                    }
+                }
+                const double mean = sum / 8.0;
+                if constexpr (std::is_integral_v<T>) {
+                    dst[(z * halfRes.y + y) * halfRes.x + x] = static_cast<T>(std::lround(mean));
+                } else {
+                    dst[(z * halfRes.y + y) * halfRes.x + x] = static_cast<T>(mean);
+                }
+            }
+        }
+    });
+    return result;
+}
+
+glm::uvec3 BrickedVolume::levelRes(glm::uvec3 res, unsigned int level) {
+    const glm::uvec3 res2 = (res + glm::uvec3((1u << level) - 1)) / (1u << level);
+    return glm::uvec3(std::max(res2.x, 1u), std::max(res2.y, 1u), std::max(res2.z, 1u));
+}
+
+BrickedVolume::BrickedVolume(const std::filesystem::path& path)
+    : file_(path),
+      type_(VoxelType::UInt8),
+      brickSize_(0) {
+    const std::string name = "Bricked volume \"" + path.string() + "\"";
+    Header header{};
+    if (file_.size() < offsetof(Header, numLevels)) {
+        throw std::runtime_error(name + " is too small!");
+    }
+    std::memcpy(&header, file_.data(), offsetof(Header, numLevels));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version < 1 ||
+        header.version > formatVersion) {
+        throw std::runtime_error(name + " has an unknown format!");
+    }
+    // Version 1 ends before the number of levels.
+    std::size_t headerSize = offsetof(Header, numLevels);
+    header.numLevels = 1;
+    if (header.version >= 2) {
+        headerSize = sizeof(Header);
+        if (file_.size() < headerSize) {
+            throw std::runtime_error(name + " is too small!");
+        }
+        std::memcpy(&header, file_.data(), headerSize);
+    }
+    if (header.voxelType > static_cast<std::uint32_t>(VoxelType::Float32) || header.brickSize == 0 ||
+        header.numLevels == 0 || header.numLevels > maxLevels) {
+        throw std::runtime_error(name + " has an invalid header!");
+    }
+    type_ = static_cast<VoxelType>(header.voxelType);
+    brickSize_ = header.brickSize;
+    const glm::uvec3 res(header.res[0], header.res[1], header.res[2]);
+    std::size_t numBricks = 0;
+    for (unsigned int level = 0; level < header.numLevels; level++) {
+        Level l{};
+        l.res = levelRes(res, level);
+        l.gridRes = (l.res + glm::uvec3(brickSize_ - 1)) / brickSize_;
+        l.firstBrick = numBricks;
+        numBricks += static_cast<std::size_t>(l.gridRes.x) * l.gridRes.y * l.gridRes.z;
+        levels_.push_back(l);
+    }
+    if (header.numBricks != numBricks || file_.size() < headerSize + numBricks * sizeof(IndexEntry)) {
+        throw std::runtime_error(name + " has an invalid index!");
+    }
+
+    index_.resize(numBricks);
+    std::memcpy(index_.data(), file_.data() + headerSize, numBricks * sizeof(IndexEntry));
+    for (const auto& entry : index_) {
+        if (entry.offset > file_.size() || entry.size > file_.size() - entry.offset ||
+            entry.encoding > Encoding::Raw) {
+            throw std::runtime_error(name + " has an invalid index!");
+        }
+    }
+}
+
+void BrickedVolume::brickExtent(std::size_t brick, glm::uvec3& origin, glm::uvec3& size, unsigned int level) const {
+    const Level& l = levels_.at(level);
+    brickExtentOf(brick, l.res, l.gridRes, brickSize_, origin, size);
+}
+
+std::vector<std::uint8_t> BrickedVolume::readBrick(std::size_t brick, unsigned int level) const {
+    if (brick >= numBricks(level)) {
+        throw std::out_of_range("Invalid brick index!");
+    }
+    glm::uvec3 origin;
+    glm::uvec3 size;
+    brickExtent(brick, origin, size, level);
+    const std::size_t voxelBytes = voxelSize(type_);
+    const std::size_t numBytes = static_cast<std::size_t>(size.x) * size.y * size.z * voxelBytes;
+
+    const IndexEntry& entry = index_[levels_[level].firstBrick + brick];
+    const std::uint8_t* data = file_.data() + entry.offset;
+    switch (entry.encoding) {
+        case Encoding::Constant: {
+            if (entry.size != voxelBytes) {
+                break;
+            }
+            std::vector<std::uint8_t> voxels(numBytes);
+            for (std::size_t i = 0; i < numBytes; i += voxelBytes) {
+                std::memcpy(voxels.data() + i, data, voxelBytes);
+            }
+            return voxels;
+        }
+        case Encoding::Deflate: {
+            std::vector<std::uint8_t> planes;
+            if (lodepng::decompress(planes, data, entry.size) != 0 || planes.size() != numBytes) {
+                break;
+            }
+            return fromBytePlanes(planes, voxelBytes);
+        }
+        case Encoding::Raw: {
+            if (entry.size != numBytes) {
+                break;
+            }
+            return std::vector<std::uint8_t>(data, data + numBytes);
+        }
+    }
+    throw std::runtime_error("Brick " + std::to_string(brick) + " of level " + std::to_string(level) +
+                             " of a bricked volume is corrupt!");
+}
+
+std::shared_ptr<std::vector<std::uint8_t>> BrickedVolume::decodeLevel(unsigned int level,
+    unsigned int numThreads) const {
+    const glm::uvec3& res = levels_.at(level).res;
+    const std::size_t voxelBytes = voxelSize(type_);
+    auto volume = std::make_shared<std::vector<std::uint8_t>>(
+        static_cast<std::size_t>(res.x) * res.y * res.z * voxelBytes);
+    // Bricks cover disjoint parts of the volume, so they can be written without synchronization.
+    parallelFor(numBricks(level), numThreads, [&](std::size_t brick) {
+        glm::uvec3 origin;
+        glm::uvec3 size;
+        brickExtent(brick, origin, size, level);
+        std::vector<std::uint8_t> brickData = readBrick(brick, level);
+        copyToVolume(volume->data(), res, brickData.data(), origin, size, voxelBytes);
+    });
+    return volume;
+}
+
+std::size_t BrickedVolume::write(const std::filesystem::path& path, VoxelType type, glm::uvec3 res,
+    const void* voxels, unsigned int brickSize, unsigned int numThreads) {
+    if (brickSize == 0) {
+        throw std::runtime_error("Invalid brick size!");
+    }
+    const std::size_t voxelBytes = voxelSize(type);
+
+    std::vector<IndexEntry> index;
+    std::vector<std::vector<std::uint8_t>> brickData;
+    // Level 0 is compressed from the input directly, each coarser level from the previous one.
+    std::vector<std::uint8_t> levelVoxels;
+    const auto* volume = static_cast<const std::uint8_t*>(voxels);
+    unsigned int numLevels = 0;
+    for (unsigned int level = 0; level < maxLevels; level++) {
+        const glm::uvec3 levelVolumeRes = levelRes(res, level);
+        if (level > 0) {
+            // The previous level is read completely before it is replaced.
+            levelVoxels = dispatchVoxelType(type, [&](auto traits) {
+                using T = typename decltype(traits)::Scalar;
+                return downsample<T>(volume, levelRes(res, level - 1), levelVolumeRes, numThreads);
+            });
+            volume = levelVoxels.data();
+        }
+
+        const glm::uvec3 gridRes = (levelVolumeRes + glm::uvec3(brickSize - 1)) / brickSize;
+        const std::size_t numBricks = static_cast<std::size_t>(gridRes.x) * gridRes.y * gridRes.z;
+        const std::size_t firstBrick = index.size();
+        index.resize(firstBrick + numBricks);
+        brickData.resize(firstBrick + numBricks);
+        parallelFor(numBricks, numThreads, [&](std::size_t brick) {
+            IndexEntry& entry = index[firstBrick + brick];
+            glm::uvec3 origin;
+            glm::uvec3 size;
+            brickExtentOf(brick, levelVolumeRes, gridRes, brickSize, origin, size);
+            std::vector<std::uint8_t> data(static_cast<std::size_t>(size.x) * size.y * size.z * voxelBytes);
+            copyFromVolume(volume, levelVolumeRes, data.data(), origin, size, voxelBytes);
+
+            bool constant = true;
+            for (std::size_t i = voxelBytes; i < data.size() && constant; i += voxelBytes) {
+                constant = std::memcmp(data.data(), data.data() + i, voxelBytes) == 0;
+            }
+            if (constant) {
+                data.resize(voxelBytes);
+                entry.encoding = Encoding::Constant;
+                brickData[firstBrick + brick] = std::move(data);
+                return;
+            }
+
+            std::vector<std::uint8_t> compressed;
+            const auto planes = toBytePlanes(data, voxelBytes);
+            if (lodepng::compress(compressed, planes.data(), planes.size()) == 0 && compressed.size() < data.size()) {
+                entry.encoding = Encoding::Deflate;
+                brickData[firstBrick + brick] = std::move(compressed);
+            } else {
+                entry.encoding = Encoding::Raw;
+                brickData[firstBrick + brick] = std::move(data);
+            }
+        });
+        numLevels++;
+        if (numBricks == 1) {
+            break;
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.voxelType = static_cast<std::uint32_t>(type);
+    header.res[0] = res.x;
+    header.res[1] = res.y;
+    header.res[2] = res.z;
+    header.brickSize = brickSize;
+    header.numBricks = index.size();
+    header.numLevels = numLevels;
+    std::uint64_t offset = sizeof(Header) + index.size() * sizeof(IndexEntry);
+    for (std::size_t brick = 0; brick < index.size(); brick++) {
+        index[brick].offset = offset;
+        index[brick].size = brickData[brick].size();
+        index[brick].reserved = 0;
+        offset += brickData[brick].size();
+    }
+
+    // Write to a temporary file first, so a failed conversion never leaves a truncated volume behind.
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(index.data()),
+            static_cast<std::streamsize>(index.size() * sizeof(IndexEntry)));
+        for (const auto& data : brickData) {
+            out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        }
+        if (!out) {
+            throw std::runtime_error("Cannot write \"" + tmpPath.string() + "\"!");
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+    return static_cast<std::size_t>(offset);
+}
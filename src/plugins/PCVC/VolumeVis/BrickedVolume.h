@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/util/MappedFile.h"
+#include "VoxelType.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Bricked volume file (.bvol). The volume is divided into bricks of brickSize^3 voxels (smaller at the upper
+     * faces), each brick is compressed independently:
+     *  - constant bricks store a single voxel,
+     *  - other bricks store their voxels as byte planes (all first bytes, all second bytes, ...) compressed with zlib,
+     *    or uncompressed if that is not smaller.
+     *
+     * Besides the full resolution (level 0), the file contains a pyramid of downsampled levels, each level halves the
+     * resolution of the previous one (2x2x2 box filter) until the volume fits into a single brick. All levels use the
+     * same brick size.
+     *
+     * Layout: Header, one IndexEntry per brick (levels from fine to coarse, x fastest), brick data. Values are stored in
+     * native byte order, like the raw files of datraw. Files of version 1 contain level 0 only.
+     *
+     * The file is memory-mapped and only the index is read on construction. Bricks can be decoded on demand with
+     * readBrick() or all at once in parallel with decodeAll(). Both are thread safe.
+     */
+    class BrickedVolume {
+    public:
+        static constexpr unsigned int defaultBrickSize = 32;
+        static constexpr unsigned int maxLevels = 16;
+
+        explicit BrickedVolume(const std::filesystem::path& path);
+
+        /**
+         * Build the level pyramid, compress the bricks in parallel and write them as bricked volume file.
+         * @param path        The output file
+         * @param type        The voxel type
+         * @param res         The volume resolution
+         * @param voxels      The voxel values, x fastest
+         * @param brickSize   The brick size in voxels
+         * @param numThreads  The number of threads, 0 uses the number of hardware threads
+         * @return The file size
+         */
+        static std::size_t write(const std::filesystem::path& path, VoxelType type, glm::uvec3 res, const void* voxels,
+            unsigned int brickSize = defaultBrickSize, unsigned int numThreads = 0);
+
+        [[nodiscard]] VoxelType type() const {
+            return type_;
+        }
+        [[nodiscard]] const glm::uvec3& res(unsigned int level = 0) const {
+            return levels_.at(level).res;
+        }
+        [[nodiscard]] unsigned int brickSize() const {
+            return brickSize_;
+        }
+        [[nodiscard]] unsigned int numLevels() const {
+            return static_cast<unsigned int>(levels_.size());
+        }
+        [[nodiscard]] const glm::uvec3& gridRes(unsigned int level = 0) const {
+            return levels_.at(level).gridRes;
+        }
+        [[nodiscard]] std::size_t numBricks(unsigned int level = 0) const {
+            const glm::uvec3& gridRes = levels_.at(level).gridRes;
+            return static_cast<std::size_t>(gridRes.x) * gridRes.y * gridRes.z;
+        }
+        /**
+         * Index of the first brick of a level in the brick order of the file.
+         */
+        [[nodiscard]] std::size_t firstBrick(unsigned int level) const {
+            return levels_.at(level).firstBrick;
+        }
+
+        /**
+         * First voxel and size of a brick.
+         */
+        void brickExtent(std::size_t brick, glm::uvec3& origin, glm::uvec3& size, unsigned int level = 0) const;
+
+        /**
+         * Decode a brick.
+         * @return The voxels of the brick, x fastest, size given by brickExtent()
+         */
+        [[nodiscard]] std::vector<std::uint8_t> readBrick(std::size_t brick, unsigned int level = 0) const;
+
+        /**
+         * Decode all bricks of a level in parallel into one volume.
+         * @param level       The pyramid level, 0 is the full resolution
+         * @param numThreads  The number of threads, 0 uses the number of hardware threads
+         */
+        [[nodiscard]] std::shared_ptr<std::vector<std::uint8_t>> decodeLevel(unsigned int level,
+            unsigned int numThreads = 0) const;
+
+        /**
+         * Decode the full resolution in parallel into one volume.
+         * @param numThreads  The number of threads, 0 uses the number of hardware threads
+         */
+        [[nodiscard]] std::shared_ptr<std::vector<std::uint8_t>> decodeAll(unsigned int numThreads = 0) const {
+            return decodeLevel(0, numThreads);
+        }
+
+        /**
+         * Resolution of a pyramid level.
+         */
+        static glm::uvec3 levelRes(glm::uvec3 res, unsigned int level);
+
+    private:
+        enum class Encoding : std::uint32_t {
+            Constant = 0,
+            Deflate = 1,
+            Raw = 2,
+        };
+
+        struct Header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t voxelType;
+            std::uint32_t res[3];
+            std::uint32_t brickSize;
+            std::uint64_t numBricks; //!< of all levels
+            std::uint32_t numLevels; //!< since version 2
+            std::uint32_t reserved;
+        };
+
+        struct IndexEntry {
+            std::uint64_t offset;
+            std::uint64_t size;
+            Encoding encoding;
+            std::uint32_t reserved;
+        };
+
+        struct Level {
+            glm::uvec3 res;
+            glm::uvec3 gridRes;
+            std::size_t firstBrick;
+        };
+
+        Core::MappedFile file_;
+        VoxelType type_;
+        unsigned int brickSize_;
+        std::vector<Level> levels_;
+        std::vector<IndexEntry> index_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,617 @@
+#include "CpuRaycaster.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <lodepng.h>
+
+#include "PreIntegratedTable.h"
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+namespace {
+    constexpr int batchSize = 8;
+    constexpr float pi = 3.14159265358979323846f;
+
+    struct Ray {
+        glm::vec3 o;
+        glm::vec3 d;
+    };
+
+    // Index wrapping of GL_REPEAT.
+    inline int wrap(int i, int n) {
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+
+    /**
+     * Trilinear sampling of the volume texture, returning normalized values like sampleVolume() in the shader.
+     */
+    template<typename T>
+    class Sampler {
+    public:
+        Sampler(const T* voxels, glm::uvec3 res, float valueScale, float valueOffset)
+            : voxels_(voxels),
+              resX_(static_cast<int>(res.x)),
+              resY_(static_cast<int>(res.y)),
+              resZ_(static_cast<int>(res.z)),
+              // Texels are normalized by the texture format, i.e. texel = value / textureMax.
+              scale_(valueScale / VoxelTraits<T>::textureMax),
+              offset_(valueOffset) {}
+
+        /**
+         * Sample `n` <= batchSize positions given in texture coordinates.
+         */
+        void sample(const float* u, const float* v, const float* w, int n, float* out) const {
+            float fx[batchSize];
+            float fy[batchSize];
+            float fz[batchSize];
+            int x0[batchSize];
+            int y0[batchSize];
+            int z0[batchSize];
+            // Texel coordinates and weights, texel centers are at (i + 0.5) / res.
+            for (int k = 0; k < n; k++) {
+                const float sx = u[k] * static_cast<float>(resX_) - 0.5f;
+                const float sy = v[k] * static_cast<float>(resY_) - 0.5f;
+                const float sz = w[k] * static_cast<float>(resZ_) - 0.5f;
+                const float flx = std::floor(sx);
+                const float fly = std::floor(sy);
+                const float flz = std::floor(sz);
+                fx[k] = sx - flx;
+                fy[k] = sy - fly;
+                fz[k] = sz - flz;
+                x0[k] = static_cast<int>(flx);
+                y0[k] = static_cast<int>(fly);
+                z0[k] = static_cast<int>(flz);
+            }
+
+            // Gather the corners.
+            float c[8][batchSize];
+            for (int k = 0; k < n; k++) {
+                const int xa = wrap(x0[k], resX_);
+                const int xb = wrap(x0[k] + 1, resX_);
+                const std::size_t ya = static_cast<std::size_t>(wrap(y0[k], resY_)) * resX_;
+                const std::size_t yb = static_cast<std::size_t>(wrap(y0[k] + 1, resY_)) * resX_;
+                const std::size_t za = static_cast<std::size_t>(wrap(z0[k], resZ_)) * resX_ * resY_;
+                const std::size_t zb = static_cast<std::size_t>(wrap(z0[k] + 1, resZ_)) * resX_ * resY_;
+                c[0][k] = static_cast<float>(voxels_[za + ya + xa]);
+                c[1][k] = static_cast<float>(voxels_[za + ya + xb]);
+                c[2][k] = static_cast<float>(voxels_[za + yb + xa]);
+                c[3][k] = static_cast<float>(voxels_[za + yb + xb]);
+                c[4][k] = static_cast<float>(voxels_[zb + ya + xa]);
+                c[5][k] = static_cast<float>(voxels_[zb + ya + xb]);
+                c[6][k] = static_cast<float>(voxels_[zb + yb + xa]);
+                c[7][k] = static_cast<float>(voxels_[zb + yb + xb]);
+            }
+
+            // Interpolate, value mapping is linear and therefore applied afterwards.
+            for (int k = 0; k < n; k++) {
+                const float c00 = c[0][k] + (c[1][k] - c[0][k]) * fx[k];
+                const float c01 = c[2][k] + (c[3][k] - c[2][k]) * fx[k];
+                const float c10 = c[4][k] + (c[5][k] - c[4][k]) * fx[k];
+                const float c11 = c[6][k] + (c[7][k] - c[6][k]) * fx[k];
+                const float c0 = c00 + (c01 - c00) * fy[k];
+                const float c1 = c10 + (c11 - c10) * fy[k];
+                out[k] = (c0 + (c1 - c0) * fz[k]) * scale_ + offset_;
+            }
+        }
+
+    private:
+        const T* voxels_;
+        int resX_;
+        int resY_;
+        int resZ_;
+        float scale_;
+        float offset_;
+    };
+
+    /**
+     * Per pixel code of volume.frag.
+     */
+    template<typename T>
+    class Shader {
+    public:
+        Shader(const Sampler<T>& sampler, glm::uvec3 res, const std::vector<float>& transferFunction,
+            const std::vector<float>& preIntegrated, const CpuRaycaster::Parameters& params)
+            : sampler_(sampler),
+              res_(res),
+              tf_(transferFunction),
+              tfSize_(static_cast<int>(transferFunction.size() / 4)),
+              preIntegrated_(preIntegrated),
+              p_(params) {}
+
+        glm::vec3 pixel(int x, int y) const {
+            const glm::vec2 texCoords((static_cast<float>(x) + 0.5f) / static_cast<float>(p_.width),
+                (static_cast<float>(y) + 0.5f) / static_cast<float>(p_.height));
+            glm::vec4 color;
+            if (!fragment(texCoords, color)) {
+                return p_.backgroundColor;
+            }
+            // Fixed point framebuffers clamp the fragment color before blending.
+            const float alpha = std::clamp(color.a, 0.0f, 1.0f);
+            return glm::clamp(glm::vec3(color), 0.0f, 1.0f) * alpha + p_.backgroundColor * (1.0f - alpha);
+        }
+
+    private:
+        static bool intersectBox(const Ray& r, glm::vec3 boxmin, glm::vec3 boxmax, float& tnear, float& tfar) {
+            tnear = (boxmin.x - r.o.x) / r.d.x;
+            tfar = (boxmax.x - r.o.x) / r.d.x;
+            if (tnear > tfar) {
+                std::swap(tnear, tfar);
+            }
+            float tymin = (boxmin.y - r.o.y) / r.d.y;
+            float tymax = (boxmax.y - r.o.y) / r.d.y;
+            if (tymin > tymax) {
+                std::swap(tymin, tymax);
+            }
+            if ((tnear > tymax) || (tymin > tfar)) {
+                return false;
+            }
+            if (tymin > tnear) {
+                tnear = tymin;
+            }
+            if (tymax < tfar) {
+                tfar = tymax;
+            }
+            float tzmin = (boxmin.z - r.o.z) / r.d.z;
+            float tzmax = (boxmax.z - r.o.z) / r.d.z;
+            if (tzmin > tzmax) {
+                std::swap(tzmin, tzmax);
+            }
+            if ((tnear > tzmax) || (tzmin > tfar)) {
+                return false;
+            }
+            if (tzmin > tnear) {
+                tnear = tzmin;
+            }
+            if (tzmax < tfar) {
+                tfar = tzmax;
+            }
+            return true;
+        }
+
+        bool isBoxEdge(glm::vec3 pos) const {
+            const glm::vec3 diffNear = glm::abs(pos - 0.5f * p_.volumeDim);
+            const glm::vec3 diffFar = glm::abs(pos + 0.5f * p_.volumeDim);
+            int count = 0;
+            for (int i = 0; i < 3; i++) {
+                count += (diffNear[i] < 0.01f) ? 1 : 0;
+                count += (diffFar[i] < 0.01f) ? 1 : 0;
+            }
+            return count >= 2;
+        }
+
+        glm::vec3 mapTexCoords(glm::vec3 pos) const {
+            return pos / p_.volumeDim + glm::vec3(0.5f);
+        }
+
+        glm::vec3 calcNormal(glm::vec3 pos) const {
+            // textureOffset() by one texel in each direction.
+            const glm::vec3 c = mapTexCoords(pos);
+            const glm::vec3 texel = 1.0f / glm::vec3(res_);
+            const float u[6] = {c.x + texel.x, c.x - texel.x, c.x, c.x, c.x, c.x};
+            const float v[6] = {c.y, c.y, c.y + texel.y, c.y - texel.y, c.y, c.y};
+            const float w[6] = {c.z, c.z, c.z, c.z, c.z + texel.z, c.z - texel.z};
+            float values[6];
+            sampler_.sample(u, v, w, 6, values);
+            return glm::normalize(glm::vec3(values[0] - values[1], values[2] - values[3], values[4] - values[5]));
+        }
+
+        glm::vec3 blinnPhong(glm::vec3 n, glm::vec3 l, glm::vec3 v) const {
+            const glm::vec3 h = glm::normalize(v + l);
+            glm::vec3 color(0.0f);
+            color += p_.kAmb * p_.ambient;
+            color += p_.kDiff * p_.diffuse * std::max(0.0f, glm::dot(n, glm::normalize(l)));
+            color += p_.kSpec * p_.specular * std::pow(std::max(0.0f, glm::dot(n, h)), p_.kExp) * (p_.kExp + 2.0f) /
+                     (2.0f * pi);
+            return color;
+        }
+
+        static float random(std::uint32_t seed) {
+            seed = (seed ^ 61u) ^ (seed >> 16u);
+            seed *= 9u;
+            seed = seed ^ (seed >> 4u);
+            seed *= 0x27d4eb2du;
+            seed = seed ^ (seed >> 15u);
+            return static_cast<float>(seed) / 4294967296.0f;
+        }
+
+        // texture(transferTex, value) with GL_LINEAR and GL_REPEAT.
+        glm::vec4 transfer(float value) const {
+            if (tfSize_ == 0 || !std::isfinite(value)) {
+                return glm::vec4(0.0f);
+            }
+            const float s = value * static_cast<float>(tfSize_) - 0.5f;
+            const float fl = std::floor(s);
+            const float f = s - fl;
+            const int i0 = wrap(static_cast<int>(fl), tfSize_);
+            const int i1 = wrap(static_cast<int>(fl) + 1, tfSize_);
+            const glm::vec4 a(tf_[4 * i0], tf_[4 * i0 + 1], tf_[4 * i0 + 2], tf_[4 * i0 + 3]);
+            const glm::vec4 b(tf_[4 * i1], tf_[4 * i1 + 1], tf_[4 * i1 + 2], tf_[4 * i1 + 3]);
+            return a + (b - a) * f;
+        }
+
+        // texture(preIntegratedTex, vec2(back, front)) with GL_LINEAR and GL_CLAMP_TO_EDGE.
+        glm::vec4 segment(float back, float front) const {
+            if (tfSize_ == 0 || !std::isfinite(back) || !std::isfinite(front)) {
+                return glm::vec4(0.0f);
+            }
+            auto texel = [this](float value, int& i0, int& i1, float& f) {
+                const float s = value * static_cast<float>(tfSize_) - 0.5f;
+                const float fl = std::floor(s);
+                f = s - fl;
+                i0 = std::clamp(static_cast<int>(fl), 0, tfSize_ - 1);
+                i1 = std::clamp(static_cast<int>(fl) + 1, 0, tfSize_ - 1);
+            };
+            int x0, x1, y0, y1;
+            float fx, fy;
+            texel(back, x0, x1, fx);
+            texel(front, y0, y1, fy);
+            auto fetch = [this](int x, int y) {
+                const float* rgba = &preIntegrated_[4 * (static_cast<std::size_t>(y) * tfSize_ + x)];
+                return glm::vec4(rgba[0], rgba[1], rgba[2], rgba[3]);
+            };
+            const glm::vec4 row0 = fetch(x0, y0) + (fetch(x1, y0) - fetch(x0, y0)) * fx;
+            const glm::vec4 row1 = fetch(x0, y1) + (fetch(x1, y1) - fetch(x0, y1)) * fx;
+            return row0 + (row1 - row0) * fy;
+        }
+
+        /**
+         * Call `fn(samplePos, value)` for the samples i = 1, 2, ... along the ray until it returns false. Sample i is
+         * at t = stepSize * (i + sampleOffset) + tNear, values are fetched in batches.
+         */
+        template<typename Fn>
+        void march(const Ray& ray, float tNear, float tFar, float sampleOffset, Fn fn) const {
+            for (int i = 1; i <= p_.maxSteps; i += batchSize) {
+                glm::vec3 pos[batchSize];
+                float u[batchSize];
+                float v[batchSize];
+                float w[batchSize];
+                int n = 0;
+                bool end = false;
+                for (; n < batchSize && i + n <= p_.maxSteps; n++) {
+                    const float tStep = p_.stepSize * (static_cast<float>(i + n) + sampleOffset) + tNear;
+                    if (tStep >= tFar) {
+                        end = true;
+                        break;
+                    }
+                    pos[n] = tStep * ray.d + ray.o;
+                    const glm::vec3 tc = mapTexCoords(pos[n]);
+                    u[n] = tc.x;
+                    v[n] = tc.y;
+                    w[n] = tc.z;
+                }
+                float values[batchSize];
+                sampler_.sample(u, v, w, n, values);
+                for (int k = 0; k < n; k++) {
+                    if (!fn(pos[k], values[k])) {
+                        return;
+                    }
+                }
+                if (end) {
+                    return;
+                }
+            }
+        }
+
+        // main() of the shader, returns false if the fragment is discarded.
+        bool fragment(glm::vec2 texCoords, glm::vec4& color) const {
+            color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            const auto seed = static_cast<int>(std::round((texCoords.x + texCoords.y * 100.0f) * 1000.0f));
+            const float offset = random(static_cast<std::uint32_t>(seed));
+
+            const glm::vec4 clipPos(2.0f * texCoords.x - 1.0f, 2.0f * texCoords.y - 1.0f, -1.0f, 1.0f);
+            Ray ray;
+            ray.o = glm::vec3(p_.invViewMx * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+            const glm::vec4 viewPoint = p_.invViewProjMx * clipPos;
+            ray.d = glm::vec3(viewPoint) / viewPoint.w - ray.o;
+            float tNear;
+            float tFar;
+            if (!intersectBox(ray, -0.5f * p_.volumeDim, 0.5f * p_.volumeDim, tNear, tFar)) {
+                return false;
+            }
+            const bool isFrontFaceEdge = isBoxEdge(tNear * ray.d + ray.o);
+            const bool isBackFaceEdge = isBoxEdge(tFar * ray.d + ray.o);
+
+            switch (p_.viewMode) {
+                case 0: { // line-of-sight
+                    float intensity = 0.0f;
+                    march(ray, tNear, tFar, 0.0f, [&](glm::vec3, float value) {
+                        intensity += value * p_.scale;
+                        return true;
+                    });
+                    color = glm::vec4(intensity, intensity, intensity, 1.0f);
+                    break;
+                }
+                case 1: { // maximum-intensity projection
+                    float intensity = 0.0f;
+                    march(ray, tNear, tFar, 0.0f, [&](glm::vec3, float value) {
+                        intensity = std::max(intensity, value);
+                        return true;
+                    });
+                    color = glm::vec4(intensity, intensity, intensity, 1.0f);
+                    break;
+                }
+                case 2: { // isosurface
+                    float sampleLastValue = 0.0f;
+                    glm::vec3 sampleLastPos = ray.o;
+                    march(ray, tNear, tFar, 0.0f, [&](glm::vec3 samplePos, float sampleValue) {
+                        if ((sampleLastValue - p_.isoValue) * (sampleValue - p_.isoValue) < 0.0f) {
+                            const glm::vec3 isoValuePos = glm::mix(sampleLastPos, samplePos,
+                                (p_.isoValue - sampleLastValue) / (sampleValue - sampleLastValue));
+                            const glm::vec3 normal = calcNormal(isoValuePos);
+                            color = glm::vec4(blinnPhong(-normal, ray.o, -ray.d), 1.0f);
+                            return false;
+                        }
+                        sampleLastValue = sampleValue;
+                        sampleLastPos = samplePos;
+                        return true;
+                    });
+                    if (!isFrontFaceEdge && !isBackFaceEdge && color == glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)) {
+                        return false;
+                    }
+                    break;
+                }
+                case 3: { // volume visualization with transfer function
+                    glm::vec4 outColor(0.0f);
+                    glm::vec3 ca(0.0f);
+                    float aa = 0.0f;
+                    const float segmentWeight = p_.preIntegration ? p_.stepSize / p_.preIntegrationStep : 1.0f;
+                    float lastIntensity = 0.0f;
+                    bool hasLast = false;
+                    march(ray, tNear, tFar, p_.useRandom ? offset : 0.0f, [&](glm::vec3, float intensity) {
+                        glm::vec3 cb;
+                        float ab;
+                        if (p_.preIntegration) {
+                            const glm::vec4 rgba = segment(intensity, hasLast ? lastIntensity : intensity);
+                            cb = glm::vec3(rgba) * p_.scale;
+                            ab = rgba.a * p_.scale;
+                            lastIntensity = intensity;
+                            hasLast = true;
+                        } else {
+                            const glm::vec4 rgba = transfer(intensity);
+                            cb = intensity * glm::vec3(rgba) * p_.scale;
+                            ab = rgba.a * p_.scale;
+                        }
+                        outColor +=
+                            segmentWeight * glm::vec4(ca * aa + cb * ab * (1.0f - aa), aa + ab * (1.0f - aa));
+                        ca = cb;
+                        aa = ab;
+                        return true;
+                    });
+                    color = outColor;
+                    break;
+                }
+                case 4: {
+                    color = glm::vec4(offset, offset, offset, 1.0f);
+                    break;
+                }
+                default: {
+                    color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+                    break;
+                }
+            }
+
+            if (p_.showBox) {
+                if (isFrontFaceEdge) {
+                    color = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+                }
+                if (isBackFaceEdge && p_.viewMode == 2 && color == glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)) {
+                    color = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+                }
+            }
+            return true;
+        }
+
+        const Sampler<T>& sampler_;
+        glm::uvec3 res_;
+        const std::vector<float>& tf_;
+        int tfSize_;
+        const std::vector<float>& preIntegrated_;
+        const CpuRaycaster::Parameters& p_;
+    };
+} // namespace
+
+std::vector<glm::vec3> CpuRaycaster::render(const Volume& volume, const std::vector<float>& transferFunction,
+    const Parameters& params, unsigned int numThreads) {
+    if (params.width <= 0 || params.height <= 0) {
+        return {};
+    }
+    std::vector<glm::vec3> image(static_cast<std::size_t>(params.width) * params.height, params.backgroundColor);
+    if (volume.voxels == nullptr || volume.res.x == 0 || volume.res.y == 0 || volume.res.z == 0) {
+        return image;
+    }
+
+    const int tilesX = (params.width + tileSize - 1) / tileSize;
+    const int tilesY = (params.height + tileSize - 1) / tileSize;
+    const int numTiles = tilesX * tilesY;
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, static_cast<unsigned int>(numTiles));
+    const std::vector<float> preIntegrated =
+        params.preIntegration ? PreIntegratedTable::build(transferFunction, numThreads) : std::vector<float>();
+
+    dispatchVoxelType(volume.type, [&](auto traits) {
+        using T = typename decltype(traits)::Scalar;
+        const Sampler<T> sampler(static_cast<const T*>(volume.voxels), volume.res, params.valueScale,
+            params.valueOffset);
+        const Shader<T> shader(sampler, volume.res, transferFunction, preIntegrated, params);
+
+        // Tiles are taken dynamically, their cost varies a lot with the volume content.
+        std::atomic<int> nextTile(0);
+        auto renderTiles = [&]() {
+            for (int tile = nextTile++; tile < numTiles; tile = nextTile++) {
+                const int x0 = (tile % tilesX) * tileSize;
+                const int y0 = (tile / tilesX) * tileSize;
+                for (int y = y0; y < std::min(y0 + tileSize, params.height); y++) {
+                    for (int x = x0; x < std::min(x0 + tileSize, params.width); x++) {
+                        image[static_cast<std::size_t>(y) * params.width + x] = shader.pixel(x, y);
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < numThreads; t++) {
+            threads.emplace_back(renderTiles);
+        }
+        renderTiles();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+    return image;
+}
+
+void CpuRaycaster::setCamera(Parameters& params, const glm::mat4& viewMx, float fovY) {
+    const float aspect = static_cast<float>(params.width) / static_cast<float>(params.height);
+    const glm::mat4 projMx = glm::perspective(glm::radians(fovY), aspect, 1.0f, 50.0f);
+    params.invViewMx = glm::inverse(viewMx);
+    params.invViewProjMx = params.invViewMx * glm::inverse(projMx);
+}
+
+void CpuRaycaster::readParameters(const std::filesystem::path& path, Parameters& params) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open \"" + path.string() + "\"!");
+    }
+    glm::mat4 viewMx = glm::inverse(params.invViewMx);
+    float fovY = 45.0f;
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+        std::istringstream values(line.substr(0, line.find('#')));
+        std::string name;
+        if (!(values >> name)) {
+            continue;
+        }
+        auto readVec3 = [&values](glm::vec3& v) { values >> v.x >> v.y >> v.z; };
+        if (name == "width") {
+            values >> params.width;
+        } else if (name == "height") {
+            values >> params.height;
+        } else if (name == "viewMx") {
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) {
+                    values >> viewMx[c][r];
+                }
+            }
+        } else if (name == "fovY") {
+            values >> fovY;
+        } else if (name == "viewMode") {
+            values >> params.viewMode;
+        } else if (name == "showBox") {
+            values >> params.showBox;
+        } else if (name == "useRandom") {
+            values >> params.useRandom;
+        } else if (name == "maxSteps") {
+            values >> params.maxSteps;
+        } else if (name == "stepSize") {
+            values >> params.stepSize;
+        } else if (name == "scale") {
+            values >> params.scale;
+        } else if (name == "isoValue") {
+            values >> params.isoValue;
+        } else if (name == "ambient") {
+            readVec3(params.ambient);
+        } else if (name == "diffuse") {
+            readVec3(params.diffuse);
+        } else if (name == "specular") {
+            readVec3(params.specular);
+        } else if (name == "kAmb") {
+            values >> params.kAmb;
+        } else if (name == "kDiff") {
+            values >> params.kDiff;
+        } else if (name == "kSpec") {
+            values >> params.kSpec;
+        } else if (name == "kExp") {
+            values >> params.kExp;
+        } else if (name == "backgroundColor") {
+            readVec3(params.backgroundColor);
+        } else if (name == "preIntegration") {
+            values >> params.preIntegration;
+        } else if (name == "preIntegrationStep") {
+            values >> params.preIntegrationStep;
+        } else {
+            throw std::runtime_error("Unknown parameter \"" + name + "\" in line " + std::to_string(lineNumber) +
+                                     " of \"" + path.string() + "\"!");
+        }
+        std::string rest;
+        if (values.fail() || values >> rest) {
+            throw std::runtime_error("Invalid values of \"" + name + "\" in line " + std::to_string(lineNumber) +
+                                     " of \"" + path.string() + "\"!");
+        }
+    }
+    if (params.width <= 0 || params.height <= 0) {
+        throw std::runtime_error("Invalid image size in \"" + path.string() + "\"!");
+    }
+    setCamera(params, viewMx, fovY);
+}
+
+void CpuRaycaster::writeParameters(const std::filesystem::path& path, const Parameters& params, float fovY) {
+    std::ofstream out(path);
+    // Enough digits to read back the same floats.
+    out.precision(9);
+    auto writeVec3 = [&out](const char* name, const glm::vec3& v) {
+        out << name << " " << v.x << " " << v.y << " " << v.z << "\n";
+    };
+    const glm::mat4 viewMx = glm::inverse(params.invViewMx);
+    out << "# Parameters of the CPU raycaster, see CpuRaycaster::readParameters()\n";
+    out << "width " << params.width << "\n";
+    out << "height " << params.height << "\n";
+    out << "viewMx";
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            out << " " << viewMx[c][r];
+        }
+    }
+    out << "\n";
+    out << "fovY " << fovY << "\n";
+    out << "viewMode " << params.viewMode << "\n";
+    out << "showBox " << params.showBox << "\n";
+    out << "useRandom " << params.useRandom << "\n";
+    out << "maxSteps " << params.maxSteps << "\n";
+    out << "stepSize " << params.stepSize << "\n";
+    out << "scale " << params.scale << "\n";
+    out << "isoValue " << params.isoValue << "\n";
+    writeVec3("ambient", params.ambient);
+    writeVec3("diffuse", params.diffuse);
+    writeVec3("specular", params.specular);
+    out << "kAmb " << params.kAmb << "\n";
+    out << "kDiff " << params.kDiff << "\n";
+    out << "kSpec " << params.kSpec << "\n";
+    out << "kExp " << params.kExp << "\n";
+    writeVec3("backgroundColor", params.backgroundColor);
+    out << "preIntegration " << params.preIntegration << "\n";
+    out << "preIntegrationStep " << params.preIntegrationStep << "\n";
+    if (!out) {
+        throw std::runtime_error("Cannot write \"" + path.string() + "\"!");
+    }
+}
+
+void CpuRaycaster::writeImage(const std::filesystem::path& path, const std::vector<glm::vec3>& image, int width,
+    int height) {
+    std::vector<unsigned char> png(image.size() * 4);
+    for (std::size_t i = 0; i < image.size(); i++) {
+        // PNG rows are top to bottom.
+        const std::size_t x = i % width;
+        const std::size_t y = height - 1 - i / width;
+        for (int c = 0; c < 3; c++) {
+            png[4 * (y * width + x) + c] =
+                static_cast<unsigned char>(std::lround(std::clamp(image[i][c], 0.0f, 1.0f) * 255.0f));
+        }
+        png[4 * (y * width + x) + 3] = 255;
+    }
+    const unsigned int error =
+        lodepng::encode(path.string(), png, static_cast<unsigned int>(width), static_cast<unsigned int>(height));
+    if (error != 0) {
+        throw std::runtime_error("Cannot write \"" + path.string() + "\": " + lodepng_error_text(error));
+    }
+}
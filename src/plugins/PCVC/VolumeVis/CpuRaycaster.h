@@ -0,0 +1,110 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "VoxelType.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * CPU reference implementation of the volume shader (resources/shaders/volume.frag). All view modes are mirrored
+     * sample by sample, including the GL_REPEAT texture wrapping, the linear transfer function lookup and the alpha
+     * blending with the background, so the result can be compared to the GPU image. Empty-space skipping is not
+     * mirrored, the reference always takes every sample.
+     *
+     * The image is split into tiles, which the threads take from a shared counter. Along each ray, samples are
+     * evaluated in batches, the trilinear kernel processes a batch in separate loops over its coordinates so the
+     * compiler can vectorize them.
+     *
+     * No OpenGL is used, so images can be rendered on machines without a GPU, e.g. with tools/cpuraycast.
+     */
+    class CpuRaycaster {
+    public:
+        static constexpr int tileSize = 16;
+
+        /**
+         * Volume data. `voxels` must contain res.x * res.y * res.z values of `type`.
+         */
+        struct Volume {
+            VoxelType type;
+            const void* voxels;
+            glm::uvec3 res;
+        };
+
+        /**
+         * The uniforms of the volume shader.
+         */
+        struct Parameters {
+            int width;  //!< viewport width
+            int height; //!< viewport height
+            glm::mat4 invViewMx;
+            glm::mat4 invViewProjMx;
+            glm::vec3 volumeDim;
+            int viewMode; //!< 0: line-of-sight, 1: mip, 2: isosurface, 3: volume, 4: noise
+            bool showBox;
+            bool useRandom;
+            int maxSteps;
+            float stepSize;
+            float scale;
+            float isoValue;
+            glm::vec3 ambient;
+            glm::vec3 diffuse;
+            glm::vec3 specular;
+            float kAmb;
+            float kDiff;
+            float kSpec;
+            float kExp;
+            float valueScale;  //!< normalized value = texel * valueScale + valueOffset
+            float valueOffset; //!< normalized value = texel * valueScale + valueOffset
+            glm::vec3 backgroundColor;
+            bool preIntegration;      //!< classify segments with the pre-integrated transfer function
+            float preIntegrationStep; //!< step size at which segments are as opaque as single samples
+        };
+
+        /**
+         * Render an image.
+         * @param volume            The volume
+         * @param transferFunction  RGBA values of the transfer function
+         * @param params            The shader parameters
+         * @param numThreads        The number of threads, 0 uses the number of hardware threads
+         * @return RGB pixels of the viewport, rows from bottom to top like glReadPixels()
+         */
+        static std::vector<glm::vec3> render(const Volume& volume, const std::vector<float>& transferFunction,
+            const Parameters& params, unsigned int numThreads = 0);
+
+        /**
+         * Set the matrices of the volume shader for a camera, like VolumeVis::render(). `width` and `height` must be
+         * set.
+         * @param params  The parameters
+         * @param viewMx  The view matrix
+         * @param fovY    The vertical field of view in degrees
+         */
+        static void setCamera(Parameters& params, const glm::mat4& viewMx, float fovY);
+
+        /**
+         * Read a parameter file. Each line holds a member of Parameters and its values separated by whitespace, '#'
+         * starts a comment. Instead of the matrices, the camera is given by `viewMx` (16 values, column by column)
+         * and `fovY` (degrees), the matrices are derived from them with setCamera(). `volumeDim`,
+         * `valueScale` and `valueOffset` depend on the volume and are not read.
+         * @param path    The parameter file
+         * @param params  Values of missing entries are kept, the camera defaults to the current matrices and 45 degrees
+         */
+        static void readParameters(const std::filesystem::path& path, Parameters& params);
+
+        /**
+         * Write a parameter file for readParameters().
+         * @param path    The parameter file
+         * @param params  The parameters
+         * @param fovY    The vertical field of view in degrees, used for the projection matrix
+         */
+        static void writeParameters(const std::filesystem::path& path, const Parameters& params, float fovY);
+
+        /**
+         * Write an image of render() as PNG.
+         */
+        static void writeImage(const std::filesystem::path& path, const std::vector<glm::vec3>& image, int width,
+            int height);
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,78 @@
+#include "GradientVolume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static std::uint8_t toUnorm8(float value) {
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+    return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+template<typename T>
+std::vector<std::uint8_t> GradientVolume::compute(const T* voxels, glm::uvec3 res, Histogram::ValueRange range,
+    unsigned int numThreads) {
+    const std::size_t numVoxels = static_cast<std::size_t>(res.x) * res.y * res.z;
+    std::vector<std::uint8_t> gradients(4 * numVoxels);
+    if (voxels == nullptr || numVoxels == 0) {
+        return gradients;
+    }
+    const float magnitudeScale = range.max > range.min ? 1.0f / (range.max - range.min) : 1.0f;
+    const std::size_t sliceSize = static_cast<std::size_t>(res.x) * res.y;
+
+    // Each thread takes every numThreads-th slice.
+    auto computeSlices = [&](unsigned int firstSlice, unsigned int sliceStep) {
+        for (unsigned int z = firstSlice; z < res.z; z += sliceStep) {
+            const T* prevSlice = voxels + ((z + res.z - 1) % res.z) * sliceSize;
+            const T* slice = voxels + z * sliceSize;
+            const T* nextSlice = voxels + ((z + 1) % res.z) * sliceSize;
+            for (unsigned int y = 0; y < res.y; y++) {
+                const std::size_t prevRow = ((y + res.y - 1) % res.y) * static_cast<std::size_t>(res.x);
+                const std::size_t row = y * static_cast<std::size_t>(res.x);
+                const std::size_t nextRow = ((y + 1) % res.y) * static_cast<std::size_t>(res.x);
+                std::uint8_t* out = gradients.data() + 4 * (z * sliceSize + row);
+                for (unsigned int x = 0; x < res.x; x++) {
+                    const unsigned int prevX = (x + res.x - 1) % res.x;
+                    const unsigned int nextX = (x + 1) % res.x;
+                    const glm::vec3 gradient(
+                        static_cast<float>(slice[row + nextX]) - static_cast<float>(slice[row + prevX]),
+                        static_cast<float>(slice[nextRow + x]) - static_cast<float>(slice[prevRow + x]),
+                        static_cast<float>(nextSlice[row + x]) - static_cast<float>(prevSlice[row + x]));
+                    const float length = std::sqrt(glm::dot(gradient, gradient));
+                    // Flat regions (and NaN) get a zero vector, like normalize() of a zero gradient gives no light.
+                    const glm::vec3 normal = length > 0.0f ? gradient / length : glm::vec3(0.0f);
+                    out[4 * x + 0] = toUnorm8(normal.x * 0.5f + 0.5f);
+                    out[4 * x + 1] = toUnorm8(normal.y * 0.5f + 0.5f);
+                    out[4 * x + 2] = toUnorm8(normal.z * 0.5f + 0.5f);
+                    out[4 * x + 3] = toUnorm8(length * magnitudeScale);
+                }
+            }
+        }
+    };
+
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, res.z);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; t++) {
+        threads.emplace_back(computeSlices, t, numThreads);
+    }
+    computeSlices(0, numThreads);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return gradients;
+}
+
+template std::vector<std::uint8_t> GradientVolume::compute(const std::uint8_t*, glm::uvec3, Histogram::ValueRange,
+    unsigned int);
+template std::vector<std::uint8_t> GradientVolume::compute(const std::uint16_t*, glm::uvec3, Histogram::ValueRange,
+    unsigned int);
+template std::vector<std::uint8_t> GradientVolume::compute(const float*, glm::uvec3, Histogram::ValueRange,
+    unsigned int);
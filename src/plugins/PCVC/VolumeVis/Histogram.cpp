@@ -0,0 +1,208 @@
+#include "Histogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <type_traits>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+// Below this size per thread, starting threads costs more than it saves.
+static constexpr std::size_t minValuesPerThread = std::size_t(1) << 20u;
+// Keeps the 32 bit counters of countRange() from overflowing.
+static constexpr std::size_t maxRangeSize = std::size_t(1) << 30u;
+
+static void countRange(const std::uint8_t* values, std::size_t numValues, Histogram::ValueCounts& counts) {
+    // Consecutive voxels often have the same value. Interleaving four tables avoids that each increment has to wait
+    // for the previous one to the same counter. Values are loaded 8 bytes at a time.
+    std::uint32_t tables[4][256] = {};
+    std::size_t i = 0;
+    for (; i + 16 <= numValues; i += 16) {
+        std::uint64_t a;
+        std::uint64_t b;
+        std::memcpy(&a, values + i, 8);
+        std::memcpy(&b, values + i + 8, 8);
+        for (unsigned int shift = 0; shift < 64; shift += 16) {
+            tables[0][(a >> shift) & 0xffu]++;
+            tables[1][(a >> (shift + 8)) & 0xffu]++;
+            tables[2][(b >> shift) & 0xffu]++;
+            tables[3][(b >> (shift + 8)) & 0xffu]++;
+        }
+    }
+    for (; i < numValues; i++) {
+        tables[0][values[i]]++;
+    }
+    for (std::size_t v = 0; v < 256; v++) {
+        counts[v] += static_cast<std::uint64_t>(tables[0][v]) + tables[1][v] + tables[2][v] + tables[3][v];
+    }
+}
+
+static void countChunk(const std::uint8_t* values, std::size_t numValues, Histogram::ValueCounts& counts) {
+    for (std::size_t offset = 0; offset < numValues; offset += maxRangeSize) {
+        countRange(values + offset, std::min(maxRangeSize, numValues - offset), counts);
+    }
+}
+
+// Split [0, numValues) into one chunk per thread and call `chunkFn(begin, end, result)` for each chunk. The calling
+// thread takes the first chunk. Returns the result of each chunk.
+template<typename Result, typename ChunkFn>
+static std::vector<Result> runChunks(std::size_t numValues, unsigned int numThreads, const Result& init,
+    ChunkFn chunkFn) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = static_cast<unsigned int>(
+        std::clamp<std::size_t>(numValues / minValuesPerThread, 1, static_cast<std::size_t>(numThreads)));
+
+    std::vector<Result> results(numThreads, init);
+    const std::size_t chunkSize = (numValues + numThreads - 1) / numThreads;
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; t++) {
+        const std::size_t begin = std::min(numValues, t * chunkSize);
+        const std::size_t end = std::min(numValues, begin + chunkSize);
+        threads.emplace_back(chunkFn, begin, end, std::ref(results[t]));
+    }
+    chunkFn(0, std::min(numValues, chunkSize), results[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+static Histogram::ValueCounts mergeCounts(const std::vector<Histogram::ValueCounts>& partialCounts) {
+    Histogram::ValueCounts counts{};
+    for (const auto& partial : partialCounts) {
+        for (std::size_t v = 0; v < counts.size(); v++) {
+            counts[v] += partial[v];
+        }
+    }
+    return counts;
+}
+
+Histogram::ValueCounts Histogram::countValues(const std::uint8_t* values, std::size_t numValues,
+    unsigned int numThreads) {
+    return mergeCounts(runChunks(numValues, numThreads, ValueCounts{},
+        [values](std::size_t begin, std::size_t end, ValueCounts& counts) {
+            countChunk(values + begin, end - begin, counts);
+        }));
+}
+
+template<typename T>
+Histogram::ValueCounts Histogram::countValues(const T* values, std::size_t numValues, ValueRange range,
+    unsigned int numThreads) {
+    if constexpr (std::is_same_v<T, std::uint8_t>) {
+        if (range.min == 0.0f && range.max == 255.0f) {
+            return countValues(values, numValues, numThreads);
+        }
+    }
+    const float offset = range.min;
+    const float scale = range.max > range.min ? 255.0f / (range.max - range.min) : 0.0f;
+    return mergeCounts(runChunks(numValues, numThreads, ValueCounts{},
+        [values, offset, scale](std::size_t begin, std::size_t end, ValueCounts& counts) {
+            for (std::size_t i = begin; i < end; i++) {
+                const float level = (static_cast<float>(values[i]) - offset) * scale + 0.5f;
+                // Written this way, NaN ends up in the first level.
+                counts[level > 0.0f ? static_cast<std::size_t>(std::min(level, 255.0f)) : 0]++;
+            }
+        }));
+}
+
+template<typename T>
+Histogram::ValueRange Histogram::valueRange(const T* values, std::size_t numValues, unsigned int numThreads) {
+    const ValueRange empty{std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+    const auto partialRanges = runChunks(numValues, numThreads, empty,
+        [values](std::size_t begin, std::size_t end, ValueRange& range) {
+            T minValue = std::numeric_limits<T>::max();
+            T maxValue = std::numeric_limits<T>::lowest();
+            for (std::size_t i = begin; i < end; i++) {
+                if constexpr (std::is_floating_point_v<T>) {
+                    if (!std::isfinite(values[i])) {
+                        continue;
+                    }
+                }
+                minValue = std::min(minValue, values[i]);
+                maxValue = std::max(maxValue, values[i]);
+            }
+            if (minValue <= maxValue) {
+                range = {static_cast<float>(minValue), static_cast<float>(maxValue)};
+            }
+        });
+
+    ValueRange range = empty;
+    for (const auto& partial : partialRanges) {
+        range.min = std::min(range.min, partial.min);
+        range.max = std::max(range.max, partial.max);
+    }
+    if (range.min > range.max) {
+        return {0.0f, 0.0f};
+    }
+    return range;
+}
+
+std::vector<float> Histogram::toBins(const ValueCounts& counts, std::size_t bins) {
+    std::vector<float> histogram(bins, 0.0f);
+    if (bins == 0) {
+        return histogram;
+    }
+    for (unsigned int v = 0; v < 256; v++) {
+        if (counts[v] == 0) {
+            continue;
+        }
+        const auto count = static_cast<float>(counts[v]);
+        if (bins <= 256) {
+            histogram[static_cast<std::size_t>(std::round(static_cast<float>(v) / 255.0f * (bins - 1)))] += count;
+        } else {
+            const auto scale = static_cast<double>((bins - 1) / 255.0f);
+            const auto first = static_cast<long long>(std::ceil(scale * (v - 0.5)));
+            const auto last = static_cast<long long>(std::floor(scale * (v + 0.5)));
+            for (long long j = std::max(first, 0ll); j <= last && j < static_cast<long long>(bins); j++) {
+                histogram[static_cast<std::size_t>(j)] += count;
+            }
+        }
+    }
+    return histogram;
+}
+
+template<typename T>
+std::vector<Histogram::BenchmarkResult> Histogram::benchmark(const T* values, std::size_t numValues, ValueRange range,
+    int repetitions) {
+    const unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int n = 1; n < maxThreads; n *= 2) {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::vector<BenchmarkResult> results;
+    for (unsigned int numThreads : threadCounts) {
+        double bestMs = 0.0;
+        for (int r = 0; r < std::max(repetitions, 1); r++) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            const ValueCounts counts = countValues(values, numValues, range, numThreads);
+            const double ms =
+                std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            // Use the result, so the counting cannot be optimized away.
+            if (counts[0] > numValues) {
+                return results;
+            }
+            bestMs = (r == 0) ? ms : std::min(bestMs, ms);
+        }
+        const double voxelsPerSecond = bestMs > 0.0 ? static_cast<double>(numValues) / (bestMs / 1000.0) : 0.0;
+        results.push_back({numThreads, bestMs, voxelsPerSecond});
+    }
+    return results;
+}
+
+template Histogram::ValueCounts Histogram::countValues(const std::uint8_t*, std::size_t, ValueRange, unsigned int);
+template Histogram::ValueCounts Histogram::countValues(const std::uint16_t*, std::size_t, ValueRange, unsigned int);
+template Histogram::ValueCounts Histogram::countValues(const float*, std::size_t, ValueRange, unsigned int);
+template Histogram::ValueRange Histogram::valueRange(const std::uint8_t*, std::size_t, unsigned int);
+template Histogram::ValueRange Histogram::valueRange(const std::uint16_t*, std::size_t, unsigned int);
+template Histogram::ValueRange Histogram::valueRange(const float*, std::size_t, unsigned int);
+template std::vector<Histogram::BenchmarkResult> Histogram::benchmark(const std::uint8_t*, std::size_t, ValueRange, int);
+template std::vector<Histogram::BenchmarkResult> Histogram::benchmark(const std::uint16_t*, std::size_t, ValueRange,
+    int);
+template std::vector<Histogram::BenchmarkResult> Histogram::benchmark(const float*, std::size_t, ValueRange, int);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Parallel histogram engine for volumes. Voxels are counted per value level with integer partial histograms per
+     * thread, which are merged afterwards. The value counts are then distributed to the requested number of bins,
+     * which is exact for any bin count.
+     *
+     * 8 bit volumes are counted per value. Volumes of other types are quantized to 256 levels of their value range.
+     * The templates are instantiated for std::uint8_t, std::uint16_t and float.
+     */
+    class Histogram {
+    public:
+        using ValueCounts = std::array<std::uint64_t, 256>;
+
+        /**
+         * Value range of a volume, which is mapped to the levels [0, 255].
+         */
+        struct ValueRange {
+            float min;
+            float max;
+        };
+
+        struct BenchmarkResult {
+            unsigned int numThreads;
+            double ms;
+            double voxelsPerSecond;
+        };
+
+        /**
+         * Count the occurrence of each value.
+         * @param values      The voxel values
+         * @param numValues   The number of voxels
+         * @param numThreads  The number of threads, 0 uses the number of hardware threads
+         */
+        static ValueCounts countValues(const std::uint8_t* values, std::size_t numValues, unsigned int numThreads = 0);
+
+        /**
+         * Count the occurrence of each level of `range`. Values outside of the range are clamped, NaN is counted as
+         * the first level.
+         */
+        template<typename T>
+        static ValueCounts countValues(const T* values, std::size_t numValues, ValueRange range,
+            unsigned int numThreads = 0);
+
+        /**
+         * Find the minimum and maximum value in a single parallel pass. Non-finite float values are ignored.
+         * @return The value range, or [0, 0] if there are no (finite) values
+         */
+        template<typename T>
+        static ValueRange valueRange(const T* values, std::size_t numValues, unsigned int numThreads = 0);
+
+        /**
+         * Distribute value counts to bins. The levels [0, 255] are mapped to [0, bins - 1]. With more than 256 bins
+         * each level is spread to all bins it covers.
+         */
+        static std::vector<float> toBins(const ValueCounts& counts, std::size_t bins);
+
+        /**
+         * Measure countValues() for 1, 2, 4, ... threads up to the number of hardware threads. Each measurement is the
+         * best of `repetitions` runs.
+         */
+        template<typename T>
+        static std::vector<BenchmarkResult> benchmark(const T* values, std::size_t numValues, ValueRange range,
+            int repetitions = 3);
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
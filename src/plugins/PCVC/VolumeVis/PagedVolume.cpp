@@ -0,0 +1,386 @@
+#include "PagedVolume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+using namespace OGL4Core2;
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+// Page table header: atlas slots per axis and brick size, number of levels, per level the resolution and the brick
+// grid with the index of its first brick. Matches the PageTable buffer of the volume shader.
+static constexpr std::size_t pageHeaderInts = 4 + 4 + 8 * BrickedVolume::maxLevels;
+static constexpr std::size_t pageHeaderBytes = pageHeaderInts * sizeof(GLint);
+
+// Level of a brick index over all levels.
+static unsigned int levelOfPage(const BrickedVolume& volume, std::size_t page) {
+    unsigned int level = 0;
+    while (level + 1 < volume.numLevels() && volume.firstBrick(level + 1) <= page) {
+        level++;
+    }
+    return level;
+}
+
+PagedVolume::PagedVolume(std::shared_ptr<const BrickedVolume> volume, std::size_t hostBudget,
+    std::size_t deviceBudget, std::size_t uploadsPerFrame, unsigned int numThreads)
+    : shared_(std::make_shared<Shared>()),
+      cache_(std::make_shared<BrickCache>(volume, hostBudget)),
+      pool_(std::make_unique<Core::ThreadPool>(numThreads)),
+      uploadsPerFrame_(uploadsPerFrame),
+      maxPending_(4 * pool_->size()),
+      slotGrid_(1),
+      slotSize_(volume->brickSize() + 1),
+      dirtyBegin_(0),
+      dirtyEnd_(0),
+      frame_(1),
+      atlasTex_(0),
+      pageTableBuffer_(0),
+      pageUsageBuffer_(0),
+      requestBuffers_{0, 0},
+      requestFences_{nullptr, nullptr},
+      requestedBricks_(0),
+      uploadedBricks_(0),
+      requestsOverflowed_(false) {
+    shared_->volume = volume;
+    shared_->cache = cache_;
+    shared_->cancelled = false;
+
+    const unsigned int coarsest = volume->numLevels() - 1;
+    const std::size_t numPages = volume->firstBrick(coarsest) + volume->numBricks(coarsest);
+    const std::size_t numPinned = volume->numBricks(coarsest);
+
+    // Arrange the slots the budget allows in a cube, limited by the maximum texture size.
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    const std::size_t slotBytes = static_cast<std::size_t>(slotSize_) * slotSize_ * slotSize_ *
+                                  voxelSize(volume->type());
+    const std::size_t maxSlotsPerAxis = std::max<std::size_t>(1, static_cast<std::size_t>(maxTextureSize) / slotSize_);
+    const std::size_t budgetSlots = std::min(deviceBudget / slotBytes, numPages);
+    const std::size_t side = std::clamp<std::size_t>(
+        static_cast<std::size_t>(std::cbrt(static_cast<double>(budgetSlots))), 1, maxSlotsPerAxis);
+    const std::size_t depth = std::clamp<std::size_t>(budgetSlots / (side * side), 1, maxSlotsPerAxis);
+    slotGrid_ = glm::uvec3(side, side, depth);
+    const std::size_t numSlots = side * side * depth;
+    if (numSlots < numPinned) {
+        throw std::runtime_error("The brick atlas budget cannot hold the coarsest level of the volume!");
+    }
+
+    slots_.assign(numSlots, {noPage, 0, false});
+    slotLruPos_.resize(numSlots);
+    for (std::size_t slot = numSlots; slot > 0; slot--) {
+        freeSlots_.push_back(slot - 1);
+    }
+    pageTable_.assign(numPages, 0);
+
+    glGenTextures(1, &atlasTex_);
+    glBindTexture(GL_TEXTURE_3D, atlasTex_);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    dispatchVoxelType(volume->type(), [this](auto traits) {
+        glTexImage3D(GL_TEXTURE_3D, 0, traits.internalFormat, static_cast<GLsizei>(slotGrid_.x * slotSize_),
+            static_cast<GLsizei>(slotGrid_.y * slotSize_), static_cast<GLsizei>(slotGrid_.z * slotSize_), 0, GL_RED,
+            traits.glType, nullptr);
+    });
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    std::vector<GLint> header(pageHeaderInts, 0);
+    header[0] = static_cast<GLint>(slotGrid_.x);
+    header[1] = static_cast<GLint>(slotGrid_.y);
+    header[2] = static_cast<GLint>(slotGrid_.z);
+    header[3] = static_cast<GLint>(volume->brickSize());
+    header[4] = static_cast<GLint>(volume->numLevels());
+    for (unsigned int level = 0; level < volume->numLevels(); level++) {
+        GLint* entry = &header[8 + 8 * level];
+        entry[0] = static_cast<GLint>(volume->res(level).x);
+        entry[1] = static_cast<GLint>(volume->res(level).y);
+        entry[2] = static_cast<GLint>(volume->res(level).z);
+        entry[4] = static_cast<GLint>(volume->gridRes(level).x);
+        entry[5] = static_cast<GLint>(volume->gridRes(level).y);
+        entry[6] = static_cast<GLint>(volume->gridRes(level).z);
+        entry[7] = static_cast<GLint>(volume->firstBrick(level));
+    }
+    glGenBuffers(1, &pageTableBuffer_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pageTableBuffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(pageHeaderBytes + numPages * sizeof(GLuint)),
+        nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, pageHeaderBytes, header.data());
+
+    // Frame stamps of the last request per brick, so each brick is requested once per frame.
+    glGenBuffers(1, &pageUsageBuffer_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pageUsageBuffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(numPages * sizeof(GLuint)), nullptr,
+        GL_DYNAMIC_DRAW);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    // Request count followed by the requested bricks.
+    glGenBuffers(2, requestBuffers_);
+    for (GLuint buffer : requestBuffers_) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (1 + maxRequests) * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The coarsest level is the fallback for every sample.
+    for (std::size_t brick = 0; brick < numPinned; brick++) {
+        upload(assembleBrick(*volume, *cache_, volume->firstBrick(coarsest) + brick), true);
+    }
+    uploadPageTable();
+}
+
+PagedVolume::~PagedVolume() {
+    // Queued tasks return immediately, running ones are waited for.
+    shared_->cancelled = true;
+    pool_ = nullptr;
+    for (GLsync& fence : requestFences_) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers(2, requestBuffers_);
+    glDeleteBuffers(1, &pageUsageBuffer_);
+    glDeleteBuffers(1, &pageTableBuffer_);
+    glDeleteTextures(1, &atlasTex_);
+}
+
+void PagedVolume::bind(glowl::GLSLProgram& shader, GLuint textureUnit) {
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, requestBuffers_[frame_ % 2]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, pageTableBinding, pageTableBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, pageUsageBinding, pageUsageBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, pageRequestBinding, requestBuffers_[frame_ % 2]);
+
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_3D, atlasTex_);
+    shader.setUniform("atlasTex", static_cast<int>(textureUnit));
+    shader.setUniform("pageFrame", static_cast<int>(frame_));
+    shader.setUniform("maxPageRequests", static_cast<int>(maxRequests));
+}
+
+void PagedVolume::update() {
+    const std::size_t current = frame_ % 2;
+    const std::size_t previous = 1 - current;
+    requestFences_[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // The feedback of the previous frame is usually complete by now. If not, it is dropped instead of waiting, the
+    // bricks are requested again by the next frames.
+    if (requestFences_[previous] != nullptr) {
+        const GLenum status = glClientWaitSync(requestFences_[previous], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            readFeedback(requestBuffers_[previous]);
+        }
+        glDeleteSync(requestFences_[previous]);
+        requestFences_[previous] = nullptr;
+    }
+    requestBricks();
+    uploadBricks();
+    frame_++;
+}
+
+PagedVolume::Statistics PagedVolume::statistics() const {
+    Statistics stats{};
+    stats.numSlots = slots_.size();
+    stats.residentBricks = slots_.size() - freeSlots_.size();
+    stats.pendingBricks = pending_.size();
+    stats.requestedBricks = requestedBricks_;
+    stats.uploadedBricks = uploadedBricks_;
+    stats.cacheSize = cache_->getSize();
+    stats.cacheHits = cache_->getHits();
+    stats.cacheMisses = cache_->getMisses();
+    stats.requestsOverflowed = requestsOverflowed_;
+    return stats;
+}
+
+PagedVolume::Upload PagedVolume::assembleBrick(const BrickedVolume& volume, BrickCache& cache, std::size_t page) {
+    const unsigned int level = levelOfPage(volume, page);
+    const std::size_t brick = page - volume.firstBrick(level);
+    const glm::uvec3 res = volume.res(level);
+    const glm::uvec3 gridRes = volume.gridRes(level);
+    const unsigned int brickSize = volume.brickSize();
+    const std::size_t voxelBytes = voxelSize(volume.type());
+
+    glm::uvec3 origin;
+    glm::uvec3 size;
+    volume.brickExtent(brick, origin, size, level);
+    Upload result{page, size + glm::uvec3(1), {}};
+    result.voxels.resize(static_cast<std::size_t>(result.size.x) * result.size.y * result.size.z * voxelBytes);
+
+    // The voxels come from at most 8 bricks, the brick itself and its upper neighbours.
+    std::vector<std::pair<std::size_t, BrickCache::Brick>> bricks;
+    auto voxel = [&](unsigned int x, unsigned int y, unsigned int z) {
+        const glm::uvec3 coord(x / brickSize, y / brickSize, z / brickSize);
+        const std::size_t index = (static_cast<std::size_t>(coord.z) * gridRes.y + coord.y) * gridRes.x + coord.x;
+        auto it = std::find_if(bricks.begin(), bricks.end(), [index](const auto& b) { return b.first == index; });
+        if (it == bricks.end()) {
+            bricks.emplace_back(index, cache.get(index, level));
+            it = bricks.end() - 1;
+        }
+        const glm::uvec3 first = coord * brickSize;
+        const glm::uvec3 dims = glm::min(res - first, glm::uvec3(brickSize));
+        const glm::uvec3 local = glm::uvec3(x, y, z) - first;
+        return it->second->data() +
+               ((static_cast<std::size_t>(local.z) * dims.y + local.y) * dims.x + local.x) * voxelBytes;
+    };
+
+    const std::size_t rowBytes = static_cast<std::size_t>(size.x) * voxelBytes;
+    const unsigned int lastX = (origin.x + size.x) % res.x;
+    std::uint8_t* dst = result.voxels.data();
+    for (unsigned int z = 0; z <= size.z; z++) {
+        const unsigned int vz = (origin.z + z) % res.z;
+        for (unsigned int y = 0; y <= size.y; y++) {
+            const unsigned int vy = (origin.y + y) % res.y;
+            std::memcpy(dst, voxel(origin.x, vy, vz), rowBytes);
+            std::memcpy(dst + rowBytes, voxel(lastX, vy, vz), voxelBytes);
+            dst += rowBytes + voxelBytes;
+        }
+    }
+    return result;
+}
+
+void PagedVolume::readFeedback(GLuint buffer) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    GLuint count = 0;
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(count), &count);
+    requestsOverflowed_ = count > maxRequests;
+    count = std::min(count, maxRequests);
+    std::vector<GLuint> pages(count);
+    if (count > 0) {
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), count * sizeof(GLuint), pages.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    requestedBricks_ = count;
+    wanted_.clear();
+    for (GLuint page : pages) {
+        if (page >= pageTable_.size()) {
+            continue;
+        }
+        if (pageTable_[page] != 0) {
+            const std::size_t slot = pageTable_[page] - 1;
+            slots_[slot].lastUsedFrame = frame_ - 1;
+            if (!slots_[slot].pinned) {
+                slotLru_.splice(slotLru_.begin(), slotLru_, slotLruPos_[slot]);
+            }
+        } else if (pending_.count(page) == 0) {
+            wanted_.push_back(page);
+        }
+    }
+}
+
+void PagedVolume::requestBricks() {
+    // Coarse bricks first, they cover more of the image and refine the fallback quickly.
+    const BrickedVolume& volume = *shared_->volume;
+    std::stable_sort(wanted_.begin(), wanted_.end(), [&volume](std::size_t a, std::size_t b) {
+        return levelOfPage(volume, a) > levelOfPage(volume, b);
+    });
+    for (std::size_t page : wanted_) {
+        if (pending_.size() >= maxPending_) {
+            break;
+        }
+        pending_.insert(page);
+        pool_->submit([shared = shared_, page]() {
+            if (shared->cancelled) {
+                return;
+            }
+            try {
+                Upload brick = assembleBrick(*shared->volume, *shared->cache, page);
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->decoded.push_back(std::move(brick));
+            } catch (const std::exception& e) {
+                // The brick stays pending, so it is not requested again.
+                std::cerr << e.what() << std::endl;
+            }
+        });
+    }
+    wanted_.clear();
+}
+
+void PagedVolume::uploadBricks() {
+    std::vector<Upload> decoded;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        const std::size_t count = std::min(uploadsPerFrame_, shared_->decoded.size());
+        std::move(shared_->decoded.begin(), shared_->decoded.begin() + static_cast<std::ptrdiff_t>(count),
+            std::back_inserter(decoded));
+        shared_->decoded.erase(shared_->decoded.begin(), shared_->decoded.begin() + static_cast<std::ptrdiff_t>(count));
+    }
+
+    uploadedBricks_ = 0;
+    for (const auto& brick : decoded) {
+        pending_.erase(brick.page);
+        // Without a replaceable slot the brick is dropped, it is requested again while it is still wanted.
+        if (upload(brick, false)) {
+            uploadedBricks_++;
+        }
+    }
+    uploadPageTable();
+}
+
+bool PagedVolume::upload(const Upload& brick, bool pin) {
+    std::size_t slot = 0;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        // Replacing a brick of the last read frame would only make both bricks alternate.
+        if (slotLru_.empty() || slots_[slotLru_.back()].lastUsedFrame + 1 >= frame_) {
+            return false;
+        }
+        slot = slotLru_.back();
+        slotLru_.pop_back();
+        pageTable_[slots_[slot].page] = 0;
+        markDirty(slots_[slot].page);
+    }
+
+    const glm::uvec3 coord(slot % slotGrid_.x, (slot / slotGrid_.x) % slotGrid_.y,
+        slot / (static_cast<std::size_t>(slotGrid_.x) * slotGrid_.y));
+    glBindTexture(GL_TEXTURE_3D, atlasTex_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    dispatchVoxelType(shared_->volume->type(), [&](auto traits) {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, static_cast<GLint>(coord.x * slotSize_),
+            static_cast<GLint>(coord.y * slotSize_), static_cast<GLint>(coord.z * slotSize_),
+            static_cast<GLsizei>(brick.size.x), static_cast<GLsizei>(brick.size.y),
+            static_cast<GLsizei>(brick.size.z), GL_RED, traits.glType, brick.voxels.data());
+    });
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    slots_[slot] = {brick.page, frame_, pin};
+    if (!pin) {
+        slotLru_.push_front(slot);
+        slotLruPos_[slot] = slotLru_.begin();
+    }
+    pageTable_[brick.page] = static_cast<GLuint>(slot + 1);
+    markDirty(brick.page);
+    return true;
+}
+
+void PagedVolume::markDirty(std::size_t page) {
+    if (dirtyBegin_ >= dirtyEnd_) {
+        dirtyBegin_ = page;
+        dirtyEnd_ = page + 1;
+    } else {
+        dirtyBegin_ = std::min(dirtyBegin_, page);
+        dirtyEnd_ = std::max(dirtyEnd_, page + 1);
+    }
+}
+
+void PagedVolume::uploadPageTable() {
+    if (dirtyBegin_ >= dirtyEnd_) {
+        return;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pageTableBuffer_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(pageHeaderBytes + dirtyBegin_ * sizeof(GLuint)),
+        static_cast<GLsizeiptr>((dirtyEnd_ - dirtyBegin_) * sizeof(GLuint)), &pageTable_[dirtyBegin_]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    dirtyBegin_ = 0;
+    dirtyEnd_ = 0;
+}
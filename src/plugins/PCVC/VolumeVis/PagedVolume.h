@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <glowl/glowl.h>
+
+#include "core/util/ThreadPool.h"
+#include "BrickCache.h"
+#include "BrickedVolume.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Out-of-core rendering of a bricked volume with its level pyramid. Only the bricks the raycaster needs are kept in
+     * a fixed size brick atlas texture, an indirection table maps each brick of each level to its atlas slot.
+     *
+     * The volume shader picks the level per sample by its screen-space footprint and falls back to coarser levels while
+     * a brick is not resident. Bricks it wanted are written to a feedback buffer, which is read one frame later to
+     * avoid a stall. Missing bricks are decoded by worker threads through a CPU-side LRU brick cache and uploaded with
+     * a limited number per frame, the least recently used atlas slots are replaced. The coarsest level always stays
+     * resident.
+     *
+     * Atlas slots hold brickSize + 1 voxels per axis, the extra voxel is copied from the next brick (wrapped like
+     * GL_REPEAT) so linear filtering within a slot matches the full resolution texture.
+     *
+     * Everything except the workers runs on the render thread.
+     */
+    class PagedVolume {
+    public:
+        static constexpr GLuint pageTableBinding = 1;
+        static constexpr GLuint pageUsageBinding = 2;
+        static constexpr GLuint pageRequestBinding = 3;
+        static constexpr GLuint maxRequests = 16384; //!< capacity of the feedback buffer per frame
+
+        struct Statistics {
+            std::size_t numSlots;         //!< atlas capacity in bricks
+            std::size_t residentBricks;   //!< bricks in the atlas
+            std::size_t pendingBricks;    //!< bricks being decoded
+            std::size_t requestedBricks;  //!< distinct bricks wanted by the last read frame
+            std::size_t uploadedBricks;   //!< bricks uploaded in the last frame
+            std::size_t cacheSize;        //!< decoded bricks in the CPU cache, bytes
+            std::size_t cacheHits;
+            std::size_t cacheMisses;
+            bool requestsOverflowed;      //!< the last read frame wanted more than maxRequests bricks
+        };
+
+        /**
+         * @param volume            The bricked volume with its level pyramid
+         * @param hostBudget        Memory budget of the CPU brick cache in bytes
+         * @param deviceBudget      Memory budget of the brick atlas in bytes
+         * @param uploadsPerFrame   Maximum number of brick uploads per frame
+         * @param numThreads        The number of decoding threads, 0 uses the number of hardware threads
+         */
+        PagedVolume(std::shared_ptr<const BrickedVolume> volume, std::size_t hostBudget, std::size_t deviceBudget,
+            std::size_t uploadsPerFrame = 32, unsigned int numThreads = 0);
+        ~PagedVolume();
+
+        PagedVolume(const PagedVolume&) = delete;
+        PagedVolume& operator=(const PagedVolume&) = delete;
+
+        /**
+         * Bind the atlas to a texture unit and the page buffers, and set the paging uniforms of the volume shader.
+         */
+        void bind(glowl::GLSLProgram& shader, GLuint textureUnit);
+
+        /**
+         * Call after the volume pass: read the feedback of the previous frame, request missing bricks and upload
+         * decoded ones.
+         */
+        void update();
+
+        void setHostBudget(std::size_t bytes) {
+            cache_->setBudget(bytes);
+        }
+        void setUploadsPerFrame(std::size_t uploads) {
+            uploadsPerFrame_ = uploads;
+        }
+
+        [[nodiscard]] Statistics statistics() const;
+
+    private:
+        struct Upload {
+            std::size_t page; //!< brick index over all levels
+            glm::uvec3 size;  //!< voxels including the extra voxel per axis
+            std::vector<std::uint8_t> voxels;
+        };
+
+        /** State shared with the decoding tasks, which may outlive the PagedVolume. */
+        struct Shared {
+            std::shared_ptr<const BrickedVolume> volume;
+            std::shared_ptr<BrickCache> cache;
+            std::atomic<bool> cancelled;
+            std::mutex mutex;
+            std::vector<Upload> decoded;
+        };
+
+        struct Slot {
+            std::size_t page;            //!< brick index over all levels, or noPage
+            std::uint64_t lastUsedFrame; //!< frame in which the raycaster wanted the brick last
+            bool pinned;                 //!< never replaced
+        };
+
+        static constexpr std::size_t noPage = ~std::size_t(0);
+
+        static Upload assembleBrick(const BrickedVolume& volume, BrickCache& cache, std::size_t page);
+        void readFeedback(GLuint buffer);
+        void requestBricks();
+        void uploadBricks();
+        bool upload(const Upload& brick, bool pin);
+        void markDirty(std::size_t page);
+        void uploadPageTable();
+
+        std::shared_ptr<Shared> shared_;
+        std::shared_ptr<BrickCache> cache_;
+        std::unique_ptr<Core::ThreadPool> pool_;
+        std::size_t uploadsPerFrame_;
+        std::size_t maxPending_;
+
+        glm::uvec3 slotGrid_;  //!< number of slots per axis
+        unsigned int slotSize_; //!< voxels per slot and axis
+        std::vector<Slot> slots_;
+        std::list<std::size_t> slotLru_; //!< unpinned occupied slots, front is most recently used
+        std::vector<std::list<std::size_t>::iterator> slotLruPos_;
+        std::vector<std::size_t> freeSlots_;
+
+        std::vector<GLuint> pageTable_; //!< 0: not resident, otherwise slot + 1
+        std::size_t dirtyBegin_;        //!< first page table entry to upload
+        std::size_t dirtyEnd_;          //!< end of the page table entries to upload
+        std::unordered_set<std::size_t> pending_;
+        std::vector<std::size_t> wanted_; //!< missing bricks of the last read feedback
+
+        std::uint64_t frame_;
+        GLuint atlasTex_;
+        GLuint pageTableBuffer_;
+        GLuint pageUsageBuffer_;
+        GLuint requestBuffers_[2];
+        GLsync requestFences_[2];
+
+        std::size_t requestedBricks_;
+        std::size_t uploadedBricks_;
+        bool requestsOverflowed_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,80 @@
+#include "PreIntegratedTable.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <thread>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+std::vector<float> PreIntegratedTable::build(const std::vector<float>& transferFunction, unsigned int numThreads) {
+    const std::size_t n = transferFunction.size() / 4;
+    std::vector<float> table(n * n * 4, 0.0f);
+    update(table, transferFunction, 0, n, numThreads);
+    return table;
+}
+
+void PreIntegratedTable::update(std::vector<float>& table, const std::vector<float>& transferFunction,
+    std::size_t first, std::size_t last, unsigned int numThreads) {
+    const std::size_t n = transferFunction.size() / 4;
+    last = std::min(last, n);
+    if (first >= last || table.size() != n * n * 4) {
+        return;
+    }
+    const double h = 1.0 / static_cast<double>(n);
+    auto center = [h](std::size_t i) { return (static_cast<double>(i) + 0.5) * h; };
+    auto entry = [&](std::size_t i, int c) { return static_cast<double>(transferFunction[4 * i + c]); };
+
+    // Integrals of value * rgb and alpha from the first entry center to each entry center, in double so the
+    // differences of close entries keep their precision.
+    std::vector<std::array<double, 4>> prefix(n, {0.0, 0.0, 0.0, 0.0});
+    for (std::size_t i = 1; i < n; i++) {
+        const double c0 = center(i - 1);
+        prefix[i] = prefix[i - 1];
+        for (int c = 0; c < 3; c++) {
+            // Integral of s * (t0 + (t1 - t0) * (s - c0) / h) over [c0, c0 + h].
+            const double t0 = entry(i - 1, c);
+            const double dt = entry(i, c) - t0;
+            prefix[i][c] += h * (c0 * t0 + c0 * dt / 2.0 + h * t0 / 2.0 + h * dt / 3.0);
+        }
+        prefix[i][3] += h * (entry(i - 1, 3) + entry(i, 3)) / 2.0;
+    }
+
+    auto buildRows = [&](std::size_t firstRow, std::size_t rowStep) {
+        for (std::size_t front = firstRow; front < n; front += rowStep) {
+            // Segments from front to back cover the entries between both, see update().
+            const std::size_t backBegin = front < first ? first : 0;
+            const std::size_t backEnd = front < last ? n : last;
+            for (std::size_t back = backBegin; back < backEnd; back++) {
+                float* rgba = &table[4 * (front * n + back)];
+                if (front == back) {
+                    // A segment of constant value is classified like a single sample.
+                    for (int c = 0; c < 3; c++) {
+                        rgba[c] = static_cast<float>(center(front) * entry(front, c));
+                    }
+                    rgba[3] = transferFunction[4 * front + 3];
+                    continue;
+                }
+                const double length = center(back) - center(front);
+                for (int c = 0; c < 4; c++) {
+                    rgba[c] = static_cast<float>((prefix[back][c] - prefix[front][c]) / length);
+                }
+            }
+        }
+    };
+
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Small tables are not worth a thread.
+    constexpr std::size_t minRowsPerThread = 64;
+    numThreads = static_cast<unsigned int>(std::clamp<std::size_t>(n / minRowsPerThread, 1, numThreads));
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; t++) {
+        threads.emplace_back(buildRows, t, numThreads);
+    }
+    buildRows(0, numThreads);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
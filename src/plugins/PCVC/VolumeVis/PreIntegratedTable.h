@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Pre-integrated classification for the volume mode. Instead of classifying single samples, each ray segment is
+     * classified by the transfer function averaged over the values between its front and back sample, assuming the
+     * value changes linearly along the segment. Thin features of sharp transfer functions are then hit even if no
+     * sample falls into them.
+     *
+     * The classified quantity is the one composited by the volume shader: (value * rgb(value), alpha(value)). The
+     * transfer function is linear between its entries like the 1D texture, so the integrals are exact and each table
+     * entry costs O(1) using prefix integrals over the entries.
+     */
+    class PreIntegratedTable {
+    public:
+        /**
+         * Build the table for the values of the transfer function entries, rows are computed in parallel.
+         * @param transferFunction  RGBA values of the n transfer function entries
+         * @param numThreads        The number of threads, 0 uses the number of hardware threads
+         * @return n * n RGBA values, x is the back value and y the front value, both at the entry centers
+         *         (i + 0.5) / n like the texels of the transfer function texture
+         */
+        static std::vector<float> build(const std::vector<float>& transferFunction, unsigned int numThreads = 0);
+
+        /**
+         * Recompute the entries of a table which depend on the transfer function entries [first, last), i.e. all
+         * segments which cover one of them: the rows [first, last), the columns [first, n) of the rows before and the
+         * columns [0, last) of the rows after. The other entries are kept.
+         * @param table             Table of build() for a transfer function of the same size
+         * @param transferFunction  RGBA values of the n transfer function entries
+         * @param first             First changed entry
+         * @param last              End of the changed entries
+         * @param numThreads        The number of threads, 0 uses the number of hardware threads
+         */
+        static void update(std::vector<float>& table, const std::vector<float>& transferFunction, std::size_t first,
+            std::size_t last, unsigned int numThreads = 0);
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
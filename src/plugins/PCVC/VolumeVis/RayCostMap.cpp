@@ -0,0 +1,135 @@
+#include "RayCostMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+RayCostMap::RayCostMap()
+    : imageSize_(0),
+      heatmapSize_(0),
+      costTex_(0),
+      heatmapTex_(0),
+      counterBuffer_(0),
+      statistics_{} {
+    glGenBuffers(1, &counterBuffer_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (1 + numTerminations) * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glGenTextures(1, &heatmapTex_);
+    glBindTexture(GL_TEXTURE_2D, heatmapTex_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+RayCostMap::~RayCostMap() {
+    glDeleteTextures(1, &costTex_);
+    glDeleteTextures(1, &heatmapTex_);
+    glDeleteBuffers(1, &counterBuffer_);
+}
+
+void RayCostMap::bind(glowl::GLSLProgram& shader, int width, int height) {
+    const glm::ivec2 size(std::max(width, 1), std::max(height, 1));
+    if (costTex_ == 0 || size != imageSize_) {
+        glDeleteTextures(1, &costTex_);
+        glGenTextures(1, &costTex_);
+        glBindTexture(GL_TEXTURE_2D, costTex_);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, size.x, size.y);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        imageSize_ = size;
+    }
+    glClearTexImage(costTex_, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer_);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindImageTexture(imageUnit, costTex_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, counterBinding, counterBuffer_);
+    shader.setUniform("recordCost", true);
+}
+
+void RayCostMap::update(const glm::ivec4& viewport, int maxSteps) {
+    // Fragments outside of the framebuffer are never written.
+    const glm::ivec2 origin = glm::clamp(glm::ivec2(viewport.x, viewport.y), glm::ivec2(0), imageSize_);
+    const glm::ivec2 end =
+        glm::clamp(glm::ivec2(viewport.x + viewport.z, viewport.y + viewport.w), origin, imageSize_);
+    const glm::ivec2 size = end - origin;
+    if (size.x == 0 || size.y == 0) {
+        return;
+    }
+
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    costs_.resize(static_cast<std::size_t>(size.x) * size.y);
+    glGetTextureSubImage(costTex_, 0, origin.x, origin.y, 0, size.x, size.y, 1, GL_RED_INTEGER, GL_UNSIGNED_INT,
+        static_cast<GLsizei>(costs_.size() * sizeof(std::uint32_t)), costs_.data());
+    GLuint counts[1 + numTerminations] = {};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer_);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // The volume pass only covers the viewport, so the counters and the image see the same rays.
+    statistics_ = {};
+    statistics_.rays = counts[0];
+    for (std::size_t t = 0; t < numTerminations; t++) {
+        statistics_.terminations[t] = counts[1 + t];
+    }
+
+    // Steps are summed in 64 bit from the image, the sum over all rays can exceed a 32 bit counter.
+    std::vector<std::uint32_t> raySteps;
+    raySteps.reserve(costs_.size());
+    heatmap_.resize(4 * costs_.size());
+    const float stepScale = 1.0f / static_cast<float>(std::max(maxSteps, 1));
+    for (std::size_t i = 0; i < costs_.size(); i++) {
+        const std::uint32_t cost = costs_[i];
+        std::array<std::uint8_t, 4> color{0, 0, 0, 0};
+        if (cost != 0) {
+            const std::uint32_t steps = cost & 0xFFFFFFu;
+            const auto termination = static_cast<Termination>((cost >> 24u) - 1u);
+            raySteps.push_back(steps);
+            statistics_.steps += steps;
+            color = termination == Termination::MaxSteps ? std::array<std::uint8_t, 4>{255, 255, 255, 255}
+                                                        : heatColor(static_cast<float>(steps) * stepScale);
+        }
+        std::copy(color.begin(), color.end(), heatmap_.begin() + static_cast<std::ptrdiff_t>(4 * i));
+    }
+    if (!raySteps.empty()) {
+        auto nth = [&raySteps](double q) {
+            const auto k = static_cast<std::size_t>(q * static_cast<double>(raySteps.size() - 1));
+            std::nth_element(raySteps.begin(), raySteps.begin() + static_cast<std::ptrdiff_t>(k), raySteps.end());
+            return raySteps[k];
+        };
+        statistics_.medianSteps = nth(0.5);
+        statistics_.p95Steps = nth(0.95);
+        statistics_.maxSteps = *std::max_element(raySteps.begin(), raySteps.end());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, heatmapTex_);
+    if (size != heatmapSize_) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, heatmap_.data());
+        heatmapSize_ = size;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, heatmap_.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Black over blue, magenta and orange to yellow, t in [0, 1].
+std::array<std::uint8_t, 4> RayCostMap::heatColor(float t) {
+    static const std::array<glm::vec3, 5> colors{
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.1f, 0.1f, 0.6f),
+        glm::vec3(0.7f, 0.1f, 0.6f),
+        glm::vec3(1.0f, 0.5f, 0.1f),
+        glm::vec3(1.0f, 1.0f, 0.3f),
+    };
+    const float x = std::clamp(t, 0.0f, 1.0f) * static_cast<float>(colors.size() - 1);
+    const auto i = std::min(static_cast<std::size_t>(x), colors.size() - 2);
+    const glm::vec3 color = glm::mix(colors[i], colors[i + 1], x - static_cast<float>(i));
+    return {static_cast<std::uint8_t>(std::lround(color.x * 255.0f)),
+        static_cast<std::uint8_t>(std::lround(color.y * 255.0f)),
+        static_cast<std::uint8_t>(std::lround(color.z * 255.0f)), 255};
+}
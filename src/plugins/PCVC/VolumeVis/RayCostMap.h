@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <glowl/glowl.h>
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Instrumentation of the ray marching in the volume shader. With `recordCost` set, each fragment writes the
+     * number of samples its ray took and why it stopped (left the volume, reached maxSteps or hit the isosurface) to
+     * an integer image and counts the termination reasons with atomic counters.
+     *
+     * After the volume pass, the image is read back, which waits for the GPU. Summary statistics are computed from it
+     * and it is colored into a heatmap texture for display with ImGui::Image().
+     */
+    class RayCostMap {
+    public:
+        static constexpr GLuint imageUnit = 0;
+        static constexpr GLuint counterBinding = 4;
+
+        enum class Termination : std::uint32_t { LeftVolume = 0, MaxSteps = 1, Surface = 2 };
+        static constexpr std::size_t numTerminations = 3;
+
+        struct Statistics {
+            std::uint64_t rays;  //!< rays which entered the volume
+            std::uint64_t steps; //!< samples taken by all rays
+            std::array<std::uint64_t, numTerminations> terminations; //!< rays per Termination
+            std::uint32_t medianSteps;
+            std::uint32_t p95Steps; //!< 95 % of the rays take at most this many samples
+            std::uint32_t maxSteps; //!< most samples of a single ray
+
+            [[nodiscard]] double meanSteps() const {
+                return rays > 0 ? static_cast<double>(steps) / static_cast<double>(rays) : 0.0;
+            }
+            [[nodiscard]] double fraction(Termination termination) const {
+                return rays > 0 ? static_cast<double>(terminations[static_cast<std::size_t>(termination)]) /
+                                      static_cast<double>(rays)
+                                : 0.0;
+            }
+        };
+
+        RayCostMap();
+        ~RayCostMap();
+
+        RayCostMap(const RayCostMap&) = delete;
+        RayCostMap& operator=(const RayCostMap&) = delete;
+
+        /**
+         * Clear the image and the counters, bind them and enable recording in the volume shader.
+         * @param width   The framebuffer width
+         * @param height  The framebuffer height
+         */
+        void bind(glowl::GLSLProgram& shader, int width, int height);
+
+        /**
+         * Call after the volume pass: read back the cost of the rays in `viewport`, update the statistics and the
+         * heatmap. Steps are colored relative to `maxSteps`, rays which reached it are drawn white.
+         */
+        void update(const glm::ivec4& viewport, int maxSteps);
+
+        [[nodiscard]] GLuint heatmapTexture() const {
+            return heatmapTex_;
+        }
+        [[nodiscard]] const glm::ivec2& heatmapSize() const {
+            return heatmapSize_;
+        }
+        [[nodiscard]] const Statistics& statistics() const {
+            return statistics_;
+        }
+
+    private:
+        static std::array<std::uint8_t, 4> heatColor(float t);
+
+        glm::ivec2 imageSize_;
+        glm::ivec2 heatmapSize_;
+        GLuint costTex_;
+        GLuint heatmapTex_;
+        GLuint counterBuffer_;
+        std::vector<std::uint32_t> costs_;
+        std::vector<std::uint8_t> heatmap_; //!< RGBA
+        Statistics statistics_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
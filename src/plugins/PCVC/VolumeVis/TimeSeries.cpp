@@ -0,0 +1,106 @@
+#include "TimeSeries.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <datraw.h>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+TimeSeries::TimeSeries(std::filesystem::path datFile, VoxelType type, glm::uvec3 res, Histogram::ValueRange range,
+    std::size_t numSteps, std::size_t firstStep, std::size_t capacity)
+    : datFile_(std::move(datFile)),
+      type_(type),
+      res_(res),
+      range_(range),
+      numSteps_(numSteps),
+      capacity_(std::max<std::size_t>(capacity, 1)),
+      next_(numSteps > 0 ? firstStep % numSteps : 0),
+      generation_(0),
+      stop_(numSteps == 0) {
+    thread_ = std::thread(&TimeSeries::run, this);
+}
+
+TimeSeries::~TimeSeries() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+bool TimeSeries::tryPop(Step& step) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ring_.empty()) {
+            return false;
+        }
+        step = std::move(ring_.front());
+        ring_.pop_front();
+    }
+    condition_.notify_all();
+    return true;
+}
+
+void TimeSeries::seek(std::size_t step) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring_.clear();
+        next_ = step % numSteps_;
+        generation_++;
+    }
+    condition_.notify_all();
+}
+
+std::size_t TimeSeries::prefetched() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ring_.size();
+}
+
+void TimeSeries::run() {
+    try {
+        // Own reader, the one of the loader is gone.
+        datraw::raw_reader<char> rd = datraw::raw_reader<char>::open(datFile_.string());
+        const std::size_t numVoxels = static_cast<std::size_t>(res_.x) * res_.y * res_.z;
+        const std::size_t numBytes = numVoxels * voxelSize(type_);
+        while (true) {
+            std::size_t index = 0;
+            std::size_t generation = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]() { return stop_ || ring_.size() < capacity_; });
+                if (stop_) {
+                    return;
+                }
+                index = next_;
+                generation = generation_;
+            }
+
+            // Read without holding the lock, playback continues meanwhile.
+            rd.move_to(index);
+            auto voxels = std::make_shared<std::vector<std::uint8_t>>(rd.read_current());
+            if (voxels->size() < numBytes) {
+                throw std::runtime_error("Time step " + std::to_string(index) + " of \"" + datFile_.string() +
+                                         "\" contains too few values!");
+            }
+            Step step{index, voxels, BrickGrid()};
+            dispatchVoxelType(type_, [&](auto traits) {
+                using T = typename decltype(traits)::Scalar;
+                step.bricks = BrickGrid::build(reinterpret_cast<const T*>(voxels->data()), res_, range_);
+            });
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (generation == generation_) {
+                ring_.push_back(std::move(step));
+                next_ = (index + 1) % numSteps_;
+            }
+        }
+    } catch (const std::exception& e) {
+        // Playback stalls from now on and reports it.
+        std::cerr << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BrickGrid.h"
+#include "Histogram.h"
+#include "VoxelType.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Prefetches the time steps of a datraw time series. A background thread reads the steps following the playback
+     * position into a bounded ring and builds their brick grids, playback wraps around at the last step. The render
+     * thread takes prefetched steps without blocking, an empty ring means the I/O falls behind.
+     */
+    class TimeSeries {
+    public:
+        struct Step {
+            std::size_t index;
+            std::shared_ptr<const std::vector<std::uint8_t>> voxels;
+            BrickGrid bricks;
+        };
+
+        /**
+         * @param datFile       The dat file of the series
+         * @param type          The voxel type of all steps
+         * @param res           The resolution of all steps
+         * @param range         The value range for the brick grids, usually the one of the first step
+         * @param numSteps      The number of time steps
+         * @param firstStep     The step to prefetch first
+         * @param capacity      The maximum number of prefetched steps
+         */
+        TimeSeries(std::filesystem::path datFile, VoxelType type, glm::uvec3 res, Histogram::ValueRange range,
+            std::size_t numSteps, std::size_t firstStep, std::size_t capacity);
+        ~TimeSeries();
+
+        TimeSeries(const TimeSeries&) = delete;
+        TimeSeries& operator=(const TimeSeries&) = delete;
+
+        [[nodiscard]] std::size_t numSteps() const {
+            return numSteps_;
+        }
+
+        /**
+         * Take the next prefetched step. Never blocks.
+         * @return false if the step is not read yet
+         */
+        bool tryPop(Step& step);
+
+        /**
+         * Drop the prefetched steps and continue prefetching at the given step.
+         */
+        void seek(std::size_t step);
+
+        /**
+         * Number of prefetched steps.
+         */
+        [[nodiscard]] std::size_t prefetched() const;
+
+    private:
+        void run();
+
+        std::filesystem::path datFile_;
+        VoxelType type_;
+        glm::uvec3 res_;
+        Histogram::ValueRange range_;
+        std::size_t numSteps_;
+        std::size_t capacity_;
+
+        std::deque<Step> ring_;
+        std::size_t next_;       //!< next step to read
+        std::size_t generation_; //!< incremented by seek(), discards a step read meanwhile
+        bool stop_;
+        mutable std::mutex mutex_;
+        std::condition_variable condition_;
+        std::thread thread_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,165 @@
+#include "TransferFunction.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "core/util/MappedFile.h"
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static constexpr char magic[8] = {'O', 'G', 'L', 'T', 'F', 'B', '\0', '\0'};
+static constexpr std::uint32_t formatVersion = 1;
+
+namespace {
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t numEntries;
+    };
+
+    /**
+     * Reads whitespace separated numbers of a string in place.
+     */
+    class Tokenizer {
+    public:
+        Tokenizer(std::string_view text, const std::string& name)
+            : begin_(text.data()),
+              pos_(text.data()),
+              end_(text.data() + text.size()),
+              name_(name) {}
+
+        template<typename T>
+        T next() {
+            while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r' || *pos_ == '\n')) {
+                pos_++;
+            }
+            // from_chars does not accept a leading '+'.
+            if (pos_ < end_ && *pos_ == '+') {
+                pos_++;
+            }
+            T value{};
+            const auto [ptr, ec] = std::from_chars(pos_, end_, value);
+            if (ec != std::errc()) {
+                throw std::runtime_error(name_ + ": " + (pos_ == end_ ? "unexpected end" : "invalid number") +
+                                         " at byte " + std::to_string(pos_ - begin_) + "!");
+            }
+            pos_ = ptr;
+            return value;
+        }
+
+    private:
+        const char* begin_;
+        const char* pos_;
+        const char* end_;
+        const std::string& name_;
+    };
+} // namespace
+
+std::vector<float> TransferFunction::read(const std::filesystem::path& path) {
+    const std::string name = "Transfer function \"" + path.string() + "\"";
+    const Core::MappedFile file(path);
+    if (path.extension() != ".tfb") {
+        return parseText(file.str(), name);
+    }
+
+    Header header{};
+    if (file.size() < sizeof(Header)) {
+        throw std::runtime_error(name + " is too small!");
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion) {
+        throw std::runtime_error(name + " has an unknown format!");
+    }
+    const std::size_t numValues = 4 * static_cast<std::size_t>(header.numEntries);
+    if (header.numEntries == 0 || file.size() < sizeof(Header) + numValues * sizeof(float)) {
+        throw std::runtime_error(name + " is too small!");
+    }
+    std::vector<float> rgba(numValues);
+    std::memcpy(rgba.data(), file.data() + sizeof(Header), numValues * sizeof(float));
+    return rgba;
+}
+
+void TransferFunction::write(const std::filesystem::path& path, const std::vector<float>& rgba) {
+    const std::size_t numEntries = rgba.size() / 4;
+    std::ofstream out(path, std::ios::binary);
+    if (path.extension() == ".tfb") {
+        Header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = formatVersion;
+        header.numEntries = static_cast<std::uint32_t>(numEntries);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(rgba.data()),
+            static_cast<std::streamsize>(4 * numEntries * sizeof(float)));
+    } else {
+        // Shortest representation which reads back to the same float.
+        std::string text = std::to_string(numEntries) + "\n";
+        char buffer[32];
+        for (std::size_t i = 0; i < 4 * numEntries; i++) {
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), rgba[i]);
+            text.append(buffer, result.ptr);
+            text += (i % 4 == 3) ? '\n' : ' ';
+        }
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write \"" + path.string() + "\"!");
+    }
+}
+
+std::vector<float> TransferFunction::parseText(std::string_view text, const std::string& name) {
+    Tokenizer tokenizer(text, name);
+    const auto numEntries = tokenizer.next<std::size_t>();
+    // Each entry needs at least 8 characters, this rejects absurd counts before allocating.
+    if (numEntries == 0 || numEntries > text.size() / 8) {
+        throw std::runtime_error(name + " has an invalid number of entries!");
+    }
+    std::vector<float> rgba(4 * numEntries);
+    for (float& value : rgba) {
+        value = tokenizer.next<float>();
+    }
+    return rgba;
+}
+
+std::vector<float> TransferFunction::resample(const std::vector<float>& rgba, std::size_t numEntries) {
+    const std::size_t n = rgba.size() / 4;
+    if (n == numEntries || n == 0) {
+        return std::vector<float>(rgba.begin(), rgba.begin() + static_cast<std::ptrdiff_t>(4 * n));
+    }
+    std::vector<float> result(4 * numEntries, 0.0f);
+    const double ratio = static_cast<double>(n) / static_cast<double>(numEntries);
+    for (std::size_t i = 0; i < numEntries; i++) {
+        float* dst = &result[4 * i];
+        if (n < numEntries) {
+            // Linear between entry centers, clamped at the ends.
+            const double x = std::clamp((static_cast<double>(i) + 0.5) * ratio - 0.5, 0.0, static_cast<double>(n - 1));
+            const auto i0 = static_cast<std::size_t>(x);
+            const std::size_t i1 = std::min(i0 + 1, n - 1);
+            const double f = x - static_cast<double>(i0);
+            for (int c = 0; c < 4; c++) {
+                dst[c] = static_cast<float>(rgba[4 * i0 + c] * (1.0 - f) + rgba[4 * i1 + c] * f);
+            }
+        } else {
+            // Average of the entries covered by [first, last), weighted by their overlap.
+            const double first = static_cast<double>(i) * ratio;
+            const double last = static_cast<double>(i + 1) * ratio;
+            double sum[4] = {0.0, 0.0, 0.0, 0.0};
+            for (auto j = static_cast<std::size_t>(first); j < n && static_cast<double>(j) < last; j++) {
+                const double weight =
+                    std::min(last, static_cast<double>(j + 1)) - std::max(first, static_cast<double>(j));
+                for (int c = 0; c < 4; c++) {
+                    sum[c] += weight * rgba[4 * j + c];
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                dst[c] = static_cast<float>(sum[c] / ratio);
+            }
+        }
+    }
+    return result;
+}
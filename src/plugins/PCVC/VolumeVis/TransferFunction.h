@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Reading and writing of transfer functions, stored as RGBA values per entry.
+     *
+     * Text files (.tf) contain the number of entries followed by four values per entry, separated by whitespace. They
+     * are parsed in a single pass with std::from_chars.
+     *
+     * Binary files (.tfb) contain a 16 byte header (magic "OGLTFB\0\0", version, number of entries) followed by the
+     * RGBA values as 32 bit floats in native byte order. They are memory-mapped and copied in one go.
+     */
+    class TransferFunction {
+    public:
+        /**
+         * Read a transfer function, the format is chosen by the extension.
+         * @return Four values per entry
+         */
+        static std::vector<float> read(const std::filesystem::path& path);
+
+        /**
+         * Write a transfer function, the format is chosen by the extension.
+         * @param path  The output file, .tfb is binary, everything else text
+         * @param rgba  Four values per entry
+         */
+        static void write(const std::filesystem::path& path, const std::vector<float>& rgba);
+
+        /**
+         * Parse the text format.
+         * @param text  The file content
+         * @param name  The name used in error messages
+         */
+        static std::vector<float> parseText(std::string_view text, const std::string& name);
+
+        /**
+         * Resample to another number of entries. Entries are treated as texels, i.e. entry i of n covers
+         * [i / n, (i + 1) / n]. Upsampling interpolates linearly between the entry centers, downsampling averages the
+         * covered entries, so narrow peaks of high-resolution transfer functions are not lost.
+         */
+        static std::vector<float> resample(const std::vector<float>& rgba, std::size_t numEntries);
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,106 @@
+#include "VolumeFile.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <datraw.h>
+
+#include "BrickedVolume.h"
+
+using namespace OGL4Core2;
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static VoxelType toVoxelType(datraw::scalar_type format) {
+    switch (format) {
+        case datraw::scalar_type::uint8:
+            return VoxelType::UInt8;
+        case datraw::scalar_type::uint16:
+            return VoxelType::UInt16;
+        case datraw::scalar_type::float32:
+            return VoxelType::Float32;
+        default:
+            throw std::runtime_error("Unsupported volume format, only UCHAR, USHORT and FLOAT are supported!");
+    }
+}
+
+VolumeFile VolumeFile::read(const std::filesystem::path& path) {
+    if (path.extension() == ".bvol") {
+        return readBricked(path);
+    }
+    return readDat(path);
+}
+
+VolumeFile VolumeFile::readDat(const std::filesystem::path& path) {
+    datraw::raw_reader<char> rd = datraw::raw_reader<char>::open(path.string());
+    VolumeFile volume;
+    volume.res = glm::uvec3(rd.info().resolution()[0], rd.info().resolution()[1], rd.info().resolution()[2]);
+    volume.type = toVoxelType(rd.info().format());
+    volume.numTimeSteps = std::max<std::size_t>(rd.info().time_steps(), 1);
+    const std::size_t numBytes =
+        static_cast<std::size_t>(volume.res.x) * volume.res.y * volume.res.z * voxelSize(volume.type);
+
+    const std::filesystem::path rawFile = rawFilePath(path, rd.info().object_file_name());
+    // Raw file names of time series are patterns, the dat file stands in for them.
+    volume.dataFile = std::filesystem::is_regular_file(rawFile) ? rawFile : path;
+
+    auto mapped = mapRawFile(rawFile, numBytes);
+    if (mapped != nullptr) {
+        volume.voxels = mapped->data();
+        volume.storage = std::move(mapped);
+    } else {
+        auto raw = std::make_shared<std::vector<datraw::uint8>>(rd.read_current());
+        if (raw->size() < numBytes) {
+            throw std::runtime_error("Volume file \"" + path.string() + "\" contains too few values!");
+        }
+        volume.voxels = raw->data();
+        volume.storage = std::move(raw);
+    }
+    return volume;
+}
+
+VolumeFile VolumeFile::readBricked(const std::filesystem::path& path) {
+    const BrickedVolume bricked(path);
+    auto decoded = bricked.decodeAll();
+    VolumeFile volume;
+    volume.res = bricked.res();
+    volume.type = bricked.type();
+    volume.numTimeSteps = 1;
+    volume.dataFile = path;
+    volume.voxels = decoded->data();
+    volume.storage = std::move(decoded);
+    return volume;
+}
+
+/**
+ * Path of the raw file of a datraw volume.
+ * @param datFile         The path of the dat file
+ * @param objectFileName  The raw file name as given in the dat file, relative to the dat file
+ */
+std::filesystem::path VolumeFile::rawFilePath(const std::filesystem::path& datFile,
+    const std::string& objectFileName) {
+    std::filesystem::path rawFile(objectFileName);
+    if (rawFile.is_relative()) {
+        rawFile = datFile.parent_path() / rawFile;
+    }
+    return rawFile;
+}
+
+/**
+ * Map the raw file of a datraw volume, if it can be used in place.
+ * @param rawFile   The path of the raw file
+ * @param numBytes  The size of the volume data in bytes
+ * @return The mapping, or nullptr if the raw file is not a plain array of the expected size
+ */
+std::shared_ptr<Core::MappedFile> VolumeFile::mapRawFile(const std::filesystem::path& rawFile, std::size_t numBytes) {
+    try {
+        auto mapped = std::make_shared<Core::MappedFile>(rawFile);
+        // Compressed data or file series do not match the size.
+        if (mapped->size() == numBytes) {
+            return mapped;
+        }
+    } catch (const std::exception&) {
+        // Fall back to datraw.
+    }
+    return nullptr;
+}
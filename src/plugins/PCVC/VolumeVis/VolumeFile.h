@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "core/util/MappedFile.h"
+#include "VoxelType.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Voxels of a volume file in memory.
+     */
+    struct VolumeFile {
+        glm::uvec3 res;
+        VoxelType type;
+        std::shared_ptr<const void> storage; //!< keeps either the memory mapping or the decoded buffer alive
+        const void* voxels;                  //!< x fastest, points into storage
+        std::size_t numTimeSteps;            //!< voxels contains the first step of a time series
+        std::filesystem::path dataFile;      //!< raw file of a datraw volume if it exists, else the read file
+
+        /**
+         * Read a datraw volume (.dat) or a bricked volume (.bvol). Uncompressed raw files of datraw volumes are
+         * memory-mapped, everything else is read completely. Bricked volumes are decoded in parallel.
+         */
+        static VolumeFile read(const std::filesystem::path& path);
+
+    private:
+        static VolumeFile readDat(const std::filesystem::path& path);
+        static VolumeFile readBricked(const std::filesystem::path& path);
+        static std::filesystem::path rawFilePath(const std::filesystem::path& datFile,
+            const std::string& objectFileName);
+        static std::shared_ptr<Core::MappedFile> mapRawFile(const std::filesystem::path& rawFile, std::size_t numBytes);
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,413 @@
+#include "VolumeStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static constexpr char magic[8] = {'O', 'G', 'L', 'V', 'S', 'T', '\0', '\0'};
+static constexpr std::uint32_t formatVersion = 3;
+static constexpr std::uint32_t numLevels = std::tuple_size_v<Histogram::ValueCounts>;
+
+namespace {
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t voxelType;
+        std::uint32_t res[3];
+        std::uint32_t numLevels; //!< of the value counts
+        std::uint32_t brickSize;
+        std::uint32_t gridRes[3];
+        std::uint64_t key; //!< see VolumeStatistics::cacheKey(), since version 3 including the data file
+        float rangeMin;
+        float rangeMax;
+        VolumeStatistics::Moments moments; //!< since version 2
+        std::uint32_t boundsMin[3];        //!< since version 2
+        std::uint32_t boundsMax[3];        //!< since version 2
+    };
+
+    /**
+     * Moments of a part of the volume, merged with the parallel variance formula of Chan et al.
+     */
+    struct PartialMoments {
+        double count = 0.0;
+        double mean = 0.0;
+        double m2 = 0.0; //!< sum of squared differences from the mean
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+
+        void merge(double otherCount, double otherMean, double otherM2, float otherMin, float otherMax) {
+            if (otherCount == 0.0) {
+                return;
+            }
+            const double total = count + otherCount;
+            const double delta = otherMean - mean;
+            mean += delta * otherCount / total;
+            m2 += otherM2 + delta * delta * count * otherCount / total;
+            count = total;
+            min = std::min(min, otherMin);
+            max = std::max(max, otherMax);
+        }
+    };
+
+    constexpr std::uint64_t hashPrime = 0x100000001b3ull;
+
+    std::uint64_t mix(std::uint64_t hash, std::uint64_t value) {
+        hash = (hash ^ value) * hashPrime;
+        return hash ^ (hash >> 29u);
+    }
+
+    // Word-wise FNV-1a variant, the bytes of an incomplete last word are padded with zeros.
+    std::uint64_t hashBytes(std::uint64_t hash, const std::uint8_t* data, std::size_t size) {
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i, 8);
+            hash = mix(hash, word);
+        }
+        if (i < size) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, data + i, size - i);
+            hash = mix(hash, word);
+        }
+        return hash;
+    }
+} // namespace
+
+template<typename T>
+void VolumeStatistics::compute(const T* voxels, glm::uvec3 res, unsigned int numThreads) {
+    bricks = BrickGrid();
+    moments = {};
+    brickMoments.clear();
+    boundsMin = glm::uvec3(0);
+    boundsMax = glm::uvec3(0);
+    if (voxels == nullptr || res.x == 0 || res.y == 0 || res.z == 0) {
+        return;
+    }
+    const glm::uvec3 gridRes = (res + glm::uvec3(BrickGrid::brickSize - 1)) / BrickGrid::brickSize;
+    const std::size_t numBricks = static_cast<std::size_t>(gridRes.x) * gridRes.y * gridRes.z;
+    std::vector<glm::vec2> ranges(numBricks);
+    brickMoments.resize(numBricks);
+    const float offset = range.min;
+    const float scale = range.max > range.min ? 1.0f / (range.max - range.min) : 1.0f;
+
+    // The border of a brick wraps around at the volume faces, see BrickGrid.
+    auto wrap = [](long long i, unsigned int n) {
+        return static_cast<unsigned int>((i + static_cast<long long>(n)) % static_cast<long long>(n));
+    };
+
+    struct Partial {
+        PartialMoments moments;
+        glm::uvec3 boundsMin{std::numeric_limits<unsigned int>::max()};
+        glm::uvec3 boundsMax{0};
+    };
+
+    // Each thread takes every numThreads-th slab of bricks. The value range of a brick includes its one voxel border,
+    // the moments and bounds only the voxels inside. Bricks are summed in double, which is exact enough for
+    // brickSize^3 values in [0, 1], and merged afterwards.
+    auto computeSlabs = [&](Partial& partial, unsigned int firstSlab, unsigned int slabStep) {
+        for (unsigned int bz = firstSlab; bz < gridRes.z; bz += slabStep) {
+            for (unsigned int by = 0; by < gridRes.y; by++) {
+                for (unsigned int bx = 0; bx < gridRes.x; bx++) {
+                    const glm::uvec3 first = glm::uvec3(bx, by, bz) * BrickGrid::brickSize;
+                    const glm::uvec3 last = glm::min(first + glm::uvec3(BrickGrid::brickSize), res);
+                    const unsigned int borderX0 = wrap(static_cast<long long>(first.x) - 1, res.x);
+                    const unsigned int borderX1 = wrap(last.x, res.x);
+                    T minRaw = std::numeric_limits<T>::max();
+                    T maxRaw = std::numeric_limits<T>::lowest();
+                    double sum = 0.0;
+                    double sumSquares = 0.0;
+                    std::size_t count = 0;
+                    float minValue = std::numeric_limits<float>::max();
+                    float maxValue = std::numeric_limits<float>::lowest();
+                    for (long long iz = static_cast<long long>(first.z) - 1; iz <= last.z; iz++) {
+                        const unsigned int z = wrap(iz, res.z);
+                        const bool insideZ = iz >= first.z && iz < last.z;
+                        for (long long iy = static_cast<long long>(first.y) - 1; iy <= last.y; iy++) {
+                            const unsigned int y = wrap(iy, res.y);
+                            const T* row = voxels + (static_cast<std::size_t>(z) * res.y + y) * res.x;
+                            minRaw = std::min({minRaw, row[borderX0], row[borderX1]});
+                            maxRaw = std::max({maxRaw, row[borderX0], row[borderX1]});
+                            if (!insideZ || iy < first.y || iy >= last.y) {
+                                for (unsigned int x = first.x; x < last.x; x++) {
+                                    minRaw = std::min(minRaw, row[x]);
+                                    maxRaw = std::max(maxRaw, row[x]);
+                                }
+                                continue;
+                            }
+                            unsigned int rowMin = last.x;
+                            unsigned int rowMax = first.x;
+                            for (unsigned int x = first.x; x < last.x; x++) {
+                                minRaw = std::min(minRaw, row[x]);
+                                maxRaw = std::max(maxRaw, row[x]);
+                                const float value = (static_cast<float>(row[x]) - offset) * scale;
+                                if constexpr (std::is_floating_point_v<T>) {
+                                    if (!std::isfinite(value)) {
+                                        continue;
+                                    }
+                                }
+                                sum += value;
+                                sumSquares += static_cast<double>(value) * value;
+                                count++;
+                                minValue = std::min(minValue, value);
+                                maxValue = std::max(maxValue, value);
+                                if (value >= backgroundThreshold) {
+                                    rowMin = std::min(rowMin, x);
+                                    rowMax = x + 1;
+                                }
+                            }
+                            if (rowMin < rowMax) {
+                                partial.boundsMin = glm::min(partial.boundsMin, glm::uvec3(rowMin, y, z));
+                                partial.boundsMax = glm::max(partial.boundsMax, glm::uvec3(rowMax, y + 1, z + 1));
+                            }
+                        }
+                    }
+                    const std::size_t brickIndex = (static_cast<std::size_t>(bz) * gridRes.y + by) * gridRes.x + bx;
+                    // A brick without finite values (only NaN) keeps the full range and is never skipped.
+                    ranges[brickIndex] = glm::vec2(0.0f, 1.0f);
+                    if (minRaw <= maxRaw) {
+                        ranges[brickIndex] = glm::vec2((static_cast<float>(minRaw) - offset) * scale,
+                            (static_cast<float>(maxRaw) - offset) * scale);
+                    }
+                    Moments& brick = brickMoments[brickIndex];
+                    brick = {};
+                    if (count > 0) {
+                        const auto n = static_cast<double>(count);
+                        const double mean = sum / n;
+                        const double m2 = std::max(sumSquares - sum * mean, 0.0);
+                        brick = {minValue, maxValue, static_cast<float>(mean), static_cast<float>(m2 / n)};
+                        partial.moments.merge(n, mean, m2, minValue, maxValue);
+                    }
+                }
+            }
+        }
+    };
+
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, gridRes.z);
+    std::vector<Partial> partials(numThreads);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < numThreads; t++) {
+        threads.emplace_back(computeSlabs, std::ref(partials[t]), t, numThreads);
+    }
+    computeSlabs(partials[0], 0, numThreads);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    bricks = BrickGrid(gridRes, std::move(ranges));
+    Partial total;
+    for (const auto& partial : partials) {
+        total.moments.merge(partial.moments.count, partial.moments.mean, partial.moments.m2, partial.moments.min,
+            partial.moments.max);
+        total.boundsMin = glm::min(total.boundsMin, partial.boundsMin);
+        total.boundsMax = glm::max(total.boundsMax, partial.boundsMax);
+    }
+    if (total.moments.count > 0.0) {
+        moments = {total.moments.min, total.moments.max, static_cast<float>(total.moments.mean),
+            static_cast<float>(total.moments.m2 / total.moments.count)};
+    }
+    if (total.boundsMin.x < total.boundsMax.x) {
+        boundsMin = total.boundsMin;
+        boundsMax = total.boundsMax;
+    }
+}
+
+template void VolumeStatistics::compute(const std::uint8_t*, glm::uvec3, unsigned int);
+template void VolumeStatistics::compute(const std::uint16_t*, glm::uvec3, unsigned int);
+template void VolumeStatistics::compute(const float*, glm::uvec3, unsigned int);
+
+float VolumeStatistics::percentile(double fraction, std::size_t firstLevel) const {
+    std::uint64_t total = 0;
+    for (std::size_t l = firstLevel; l < counts.size(); l++) {
+        total += counts[l];
+    }
+    if (total == 0) {
+        return 0.0f;
+    }
+    // Level l covers the normalized values [(l - 0.5) / 255, (l + 0.5) / 255), see Histogram::countValues().
+    const double target = std::clamp(fraction, 0.0, 1.0) * static_cast<double>(total);
+    double below = 0.0;
+    for (std::size_t l = firstLevel; l < counts.size(); l++) {
+        const auto count = static_cast<double>(counts[l]);
+        if (count > 0.0 && below + count >= target) {
+            const double level = static_cast<double>(l) - 0.5 + (target - below) / count;
+            return std::clamp(static_cast<float>(level / 255.0), 0.0f, 1.0f);
+        }
+        below += count;
+    }
+    return 1.0f;
+}
+
+VolumeStatistics::Parameters VolumeStatistics::parameters(glm::uvec3 res, glm::vec3 volumeDim, float stepSize) const {
+    Parameters params{std::numeric_limits<int>::max(), 1.0f, 0.5f};
+
+    // Every ray through the bounding box of the volume ends before the last step.
+    const double diagonal = std::sqrt(static_cast<double>(volumeDim.x) * volumeDim.x +
+                                      static_cast<double>(volumeDim.y) * volumeDim.y +
+                                      static_cast<double>(volumeDim.z) * volumeDim.z);
+    if (stepSize > 0.0f) {
+        params.maxSteps = static_cast<int>(std::min(std::ceil(diagonal / stepSize) + 1.0,
+            static_cast<double>(std::numeric_limits<int>::max())));
+    }
+
+    // Line-of-sight sums the samples. An average ray through the content, i.e. along the mean edge length of its
+    // bounding box, through voxels of the mean value inside the box is mapped to 1. Background voxels are ~0, so the
+    // mean inside the box follows from the mean of the volume.
+    const bool hasContent = boundsMin.x < boundsMax.x;
+    const glm::uvec3 extent = hasContent ? boundsMax - boundsMin : res;
+    const double numVoxels = static_cast<double>(res.x) * res.y * res.z;
+    const double contentVoxels = static_cast<double>(extent.x) * extent.y * extent.z;
+    const double contentMean = contentVoxels > 0.0 ? moments.mean * numVoxels / contentVoxels : 0.0;
+    const double pathLength = (static_cast<double>(extent.x) / res.x * volumeDim.x +
+                                  static_cast<double>(extent.y) / res.y * volumeDim.y +
+                                  static_cast<double>(extent.z) / res.z * volumeDim.z) /
+                              3.0;
+    if (stepSize > 0.0f && contentMean > 0.0 && pathLength > 0.0) {
+        params.scale = static_cast<float>(stepSize / (contentMean * pathLength));
+    }
+
+    // Half way between the background and the typical content value, like the half-maximum edge criterion.
+    std::uint64_t contentCount = 0;
+    for (std::size_t l = 1; l < counts.size(); l++) {
+        contentCount += counts[l];
+    }
+    const float contentMedian = percentile(0.5, contentCount > 0 ? 1 : 0);
+    params.isoValue = 0.5f * (moments.min + contentMedian);
+    return params;
+}
+
+std::uint64_t VolumeStatistics::cacheKey(const std::filesystem::path& dataFile, const void* voxels, glm::uvec3 res,
+    VoxelType type) {
+    constexpr std::size_t blockSize = std::size_t(64) << 10u;
+    constexpr std::size_t numBlocks = 64;
+
+    const std::size_t numBytes = static_cast<std::size_t>(res.x) * res.y * res.z * voxelSize(type);
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    // Catches edits outside of the sampled blocks, unless they keep the size and the modification time. A file which
+    // cannot be stat'ed only contributes the error values.
+    std::error_code ec;
+    const std::uintmax_t fileSize = std::filesystem::file_size(dataFile, ec);
+    hash = mix(hash, ec ? 0 : static_cast<std::uint64_t>(fileSize));
+    const auto writeTime = std::filesystem::last_write_time(dataFile, ec);
+    hash = mix(hash, ec ? 0 : static_cast<std::uint64_t>(writeTime.time_since_epoch().count()));
+    hash = mix(hash, res.x);
+    hash = mix(hash, res.y);
+    hash = mix(hash, res.z);
+    hash = mix(hash, static_cast<std::uint64_t>(type));
+    const auto* bytes = static_cast<const std::uint8_t*>(voxels);
+    if (bytes == nullptr) {
+        return hash;
+    }
+    if (numBytes <= blockSize * numBlocks) {
+        return hashBytes(hash, bytes, numBytes);
+    }
+    // The first and the last block are always included, the others are spread evenly in between.
+    for (std::size_t b = 0; b < numBlocks; b++) {
+        hash = hashBytes(hash, bytes + b * (numBytes - blockSize) / (numBlocks - 1), blockSize);
+    }
+    return hash;
+}
+
+std::filesystem::path VolumeStatistics::cachePath(const std::filesystem::path& volumeFile) {
+    std::filesystem::path path = volumeFile;
+    path += ".stats";
+    return path;
+}
+
+std::optional<VolumeStatistics> VolumeStatistics::load(const std::filesystem::path& path, std::uint64_t key,
+    glm::uvec3 res, VoxelType type) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+    Header header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(Header));
+    if (!in || std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion ||
+        header.key != key || header.voxelType != static_cast<std::uint32_t>(type) || header.res[0] != res.x ||
+        header.res[1] != res.y || header.res[2] != res.z || header.numLevels != numLevels ||
+        header.brickSize != BrickGrid::brickSize) {
+        return std::nullopt;
+    }
+    const glm::uvec3 gridRes(header.gridRes[0], header.gridRes[1], header.gridRes[2]);
+    if (gridRes != (res + glm::uvec3(BrickGrid::brickSize - 1)) / BrickGrid::brickSize) {
+        return std::nullopt;
+    }
+
+    VolumeStatistics stats;
+    stats.range = {header.rangeMin, header.rangeMax};
+    stats.moments = header.moments;
+    stats.boundsMin = glm::uvec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    stats.boundsMax = glm::uvec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    const std::size_t numBricks = static_cast<std::size_t>(gridRes.x) * gridRes.y * gridRes.z;
+    in.read(reinterpret_cast<char*>(stats.counts.data()), sizeof(Histogram::ValueCounts));
+    std::vector<glm::vec2> ranges(numBricks);
+    in.read(reinterpret_cast<char*>(ranges.data()), static_cast<std::streamsize>(numBricks * sizeof(glm::vec2)));
+    stats.brickMoments.resize(numBricks);
+    in.read(reinterpret_cast<char*>(stats.brickMoments.data()),
+        static_cast<std::streamsize>(numBricks * sizeof(Moments)));
+    if (!in) {
+        return std::nullopt;
+    }
+    stats.bricks = BrickGrid(gridRes, std::move(ranges));
+    return stats;
+}
+
+void VolumeStatistics::store(const std::filesystem::path& path, std::uint64_t key, glm::uvec3 res,
+    VoxelType type) const {
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.voxelType = static_cast<std::uint32_t>(type);
+    header.res[0] = res.x;
+    header.res[1] = res.y;
+    header.res[2] = res.z;
+    header.numLevels = numLevels;
+    header.brickSize = BrickGrid::brickSize;
+    header.gridRes[0] = bricks.res().x;
+    header.gridRes[1] = bricks.res().y;
+    header.gridRes[2] = bricks.res().z;
+    header.key = key;
+    header.rangeMin = range.min;
+    header.rangeMax = range.max;
+    header.moments = moments;
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+    }
+
+    // Written to a temporary file first, so a concurrent or interrupted write never leaves a truncated cache behind.
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(counts.data()), sizeof(Histogram::ValueCounts));
+        out.write(reinterpret_cast<const char*>(bricks.ranges().data()),
+            static_cast<std::streamsize>(bricks.ranges().size() * sizeof(glm::vec2)));
+        out.write(reinterpret_cast<const char*>(brickMoments.data()),
+            static_cast<std::streamsize>(brickMoments.size() * sizeof(Moments)));
+        if (!out) {
+            throw std::runtime_error("Cannot write \"" + tmpPath.string() + "\"!");
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        throw std::runtime_error("Cannot write \"" + path.string() + "\"!");
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BrickGrid.h"
+#include "Histogram.h"
+#include "VoxelType.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Statistics of a volume which need a full pass over the voxels: value range, value counts for the histogram, the
+     * min/max brick grid, moments of the whole volume and of each brick, and the bounding box of the voxels which are
+     * not background. They are cached in a sidecar file next to the volume (<volume>.stats), so re-opening a volume
+     * skips the pass.
+     *
+     * The cache is keyed by cacheKey(), the number of histogram levels, the brick size, the resolution and the voxel
+     * type. The value counts are stored per level, so any number of histogram bins is derived from them.
+     *
+     * Layout: Header, value counts, brick ranges, brick moments. Values are stored in native byte order.
+     */
+    struct VolumeStatistics {
+        /**
+         * Voxels below this normalized value, i.e. the first histogram level, are background.
+         */
+        static constexpr float backgroundThreshold = 0.5f / 255.0f;
+
+        /**
+         * Moments of normalized values. Non-finite float values are ignored, without any values all are 0.
+         */
+        struct Moments {
+            float min;
+            float max;
+            float mean;
+            float variance;
+        };
+
+        /**
+         * Render parameters derived from the statistics.
+         */
+        struct Parameters {
+            int maxSteps;   //!< steps along the volume diagonal
+            float scale;    //!< line-of-sight scale which maps an average ray through the content to 1
+            float isoValue; //!< half way from the background to the median of the content
+        };
+
+        Histogram::ValueRange range;
+        Histogram::ValueCounts counts;
+        BrickGrid bricks;
+        Moments moments;                   //!< of the whole volume
+        std::vector<Moments> brickMoments; //!< per brick in the layout of BrickGrid, without the border
+        glm::uvec3 boundsMin;              //!< first voxel of the bounding box of the non-background voxels
+        glm::uvec3 boundsMax;              //!< end of the bounding box, equal to boundsMin if all are background
+
+        /**
+         * Compute the brick grid, moments, brick moments and bounds in one parallel pass over slabs of bricks. `range`
+         * must be set, the brick grid equals BrickGrid::build() with it.
+         * @param voxels      The voxel values
+         * @param res         The volume resolution
+         * @param numThreads  The number of threads, 0 uses the number of hardware threads
+         */
+        template<typename T>
+        void compute(const T* voxels, glm::uvec3 res, unsigned int numThreads = 0);
+
+        /**
+         * Normalized value below which `fraction` of the voxels lie, interpolated within the histogram levels.
+         * @param fraction    The fraction in [0, 1]
+         * @param firstLevel  Levels below are not counted, 1 excludes the background
+         */
+        [[nodiscard]] float percentile(double fraction, std::size_t firstLevel = 0) const;
+
+        /**
+         * Derive render parameters. Needs the counts, moments and bounds.
+         * @param res        The volume resolution
+         * @param volumeDim  The volume dimensions, like the volume shader
+         * @param stepSize   The step size of the ray marching
+         */
+        [[nodiscard]] Parameters parameters(glm::uvec3 res, glm::vec3 volumeDim, float stepSize) const;
+
+        /**
+         * Fast key of the cache. The size and modification time of the data file, resolution, type and 64 evenly
+         * spaced blocks of 64 KiB of the voxels are hashed, volumes up to 4 MiB completely. The key is not
+         * content-exact: an edit which keeps the file size and modification time and does not touch a sampled block
+         * is not detected.
+         * @param dataFile  The file the voxels were read from, see VolumeFile::dataFile
+         * @param voxels    The voxel values, may be nullptr to hash the file and the layout only
+         * @param res       The volume resolution
+         * @param type      The voxel type
+         */
+        static std::uint64_t cacheKey(const std::filesystem::path& dataFile, const void* voxels, glm::uvec3 res,
+            VoxelType type);
+
+        /**
+         * Path of the cache file of a volume file.
+         */
+        static std::filesystem::path cachePath(const std::filesystem::path& volumeFile);
+
+        /**
+         * Read the cache file.
+         * @return The statistics, or nothing if the file is missing, damaged or of another volume
+         */
+        static std::optional<VolumeStatistics> load(const std::filesystem::path& path, std::uint64_t key,
+            glm::uvec3 res, VoxelType type);
+
+        /**
+         * Write the cache file, replacing an existing one. `brickMoments` must have one entry per brick of `bricks`.
+         */
+        void store(const std::filesystem::path& path, std::uint64_t key, glm::uvec3 res, VoxelType type) const;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
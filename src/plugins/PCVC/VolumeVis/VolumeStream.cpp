@@ -0,0 +1,187 @@
+#include "VolumeStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static constexpr GLbitfield pboFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+VolumeStream::VolumeStream(GLuint texture, glm::uvec3 res, VoxelType type, Histogram::ValueRange range,
+    const void* voxels, std::shared_ptr<const void> storage, bool count, std::size_t slabBytes, std::size_t ringSize)
+    : texture_(texture),
+      res_(res),
+      type_(type),
+      range_(range),
+      voxels_(static_cast<const std::uint8_t*>(voxels)),
+      count_(count),
+      storage_(std::move(storage)),
+      sliceBytes_(static_cast<std::size_t>(res.x) * res.y * voxelSize(type)),
+      slabDepth_(0),
+      numSlabs_(0),
+      nextUpload_(0),
+      producing_(false),
+      cancelled_(false) {
+    if (sliceBytes_ == 0 || res.z == 0) {
+        return;
+    }
+    slabDepth_ = static_cast<GLuint>(std::clamp<std::size_t>(slabBytes / sliceBytes_, 1, res.z));
+    numSlabs_ = (res.z + slabDepth_ - 1) / slabDepth_;
+
+    const auto pboSize = static_cast<GLsizeiptr>(sliceBytes_ * slabDepth_);
+    slots_.resize(std::min(std::max<std::size_t>(ringSize, 1), numSlabs_));
+    for (auto& slot : slots_) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, pboSize, nullptr, pboFlags);
+        slot.ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pboSize, pboFlags);
+        slot.fence = nullptr;
+        slot.state = SlotState::Free;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+VolumeStream::~VolumeStream() {
+    // The last reference may be released on a worker thread, therefore no GL calls here. Buffers are released by
+    // upload() when done or by cancel().
+}
+
+std::optional<Histogram::ValueCounts> VolumeStream::produce() {
+    Histogram::ValueCounts counts{};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            return std::nullopt;
+        }
+        producing_ = true;
+    }
+
+    for (std::size_t s = 0; s < numSlabs_; s++) {
+        Slot& slot = slots_[s % slots_.size()];
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this, &slot]() { return cancelled_ || slot.state == SlotState::Free; });
+            if (cancelled_) {
+                break;
+            }
+        }
+        const std::size_t firstSlice = s * slabDepth_;
+        const std::size_t numBytes = std::min<std::size_t>(slabDepth_, res_.z - firstSlice) * sliceBytes_;
+        const std::uint8_t* src = voxels_ + firstSlice * sliceBytes_;
+        // Reading the slab faults in the pages of a mapped file, so disk I/O happens here and not on upload.
+        if (count_) {
+            // Single-threaded: the slabs are small, starting threads for each of them costs more than it saves.
+            const Histogram::ValueCounts slabCounts = dispatchVoxelType(type_, [&](auto traits) {
+                using T = typename decltype(traits)::Scalar;
+                return Histogram::countValues(reinterpret_cast<const T*>(src), numBytes / sizeof(T), range_, 1);
+            });
+            for (std::size_t v = 0; v < counts.size(); v++) {
+                counts[v] += slabCounts[v];
+            }
+        }
+        std::memcpy(slot.ptr, src, numBytes);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.state = SlotState::Filled;
+        }
+    }
+
+    bool cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        producing_ = false;
+        cancelled = cancelled_;
+    }
+    condition_.notify_all();
+    if (cancelled || !count_) {
+        return std::nullopt;
+    }
+    return counts;
+}
+
+bool VolumeStream::upload() {
+    bool recycled = false;
+    bool inFlight = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            return true;
+        }
+
+        // Hand buffers back to the producer once the GPU has read them.
+        for (auto& slot : slots_) {
+            if (slot.state != SlotState::InFlight) {
+                continue;
+            }
+            const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+                slot.state = SlotState::Free;
+                recycled = true;
+            } else {
+                inFlight = true;
+            }
+        }
+
+        // Upload filled slabs in order.
+        while (nextUpload_ < numSlabs_) {
+            Slot& slot = slots_[nextUpload_ % slots_.size()];
+            if (slot.state != SlotState::Filled) {
+                break;
+            }
+            const auto firstSlice = static_cast<GLuint>(nextUpload_ * slabDepth_);
+            const GLuint depth = std::min(slabDepth_, res_.z - firstSlice);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glBindTexture(GL_TEXTURE_3D, texture_);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, static_cast<GLint>(firstSlice), static_cast<GLsizei>(res_.x),
+                static_cast<GLsizei>(res_.y), static_cast<GLsizei>(depth), GL_RED,
+                dispatchVoxelType(type_, [](auto traits) { return traits.glType; }), nullptr);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindTexture(GL_TEXTURE_3D, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            slot.state = SlotState::InFlight;
+            inFlight = true;
+            nextUpload_++;
+        }
+    }
+    if (recycled) {
+        condition_.notify_all();
+    }
+
+    if (nextUpload_ < numSlabs_ || inFlight) {
+        return false;
+    }
+    releaseBuffers();
+    return true;
+}
+
+void VolumeStream::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+    }
+    condition_.notify_all();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() { return !producing_; });
+    }
+    releaseBuffers();
+}
+
+void VolumeStream::releaseBuffers() {
+    for (auto& slot : slots_) {
+        if (slot.fence != nullptr) {
+            glDeleteSync(slot.fence);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    slots_.clear();
+    storage_.reset();
+}
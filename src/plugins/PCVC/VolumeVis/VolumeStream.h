@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "Histogram.h"
+#include "VoxelType.h"
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Streams a volume slab by slab into an allocated 3D texture. A worker thread copies slabs of slices into
+     * a small ring of persistently mapped pixel buffer objects and optionally counts the values for the histogram. The
+     * render thread uploads filled buffers with glTexSubImage3D and hands them back once the GPU has consumed them.
+     * Staging memory is bounded by the ring size, independent of the volume size.
+     *
+     * produce() runs on a worker thread, everything else on the render thread.
+     */
+    class VolumeStream {
+    public:
+        /**
+         * @param texture   3D texture with allocated storage of size `res` in the format of `type`
+         * @param res       volume resolution
+         * @param type      voxel type
+         * @param range     value range for the histogram levels
+         * @param voxels    voxel data, e.g. a memory-mapped raw file
+         * @param storage   keeps `voxels` alive while streaming
+         * @param count     count the values for the histogram while streaming
+         * @param slabBytes approximate size of one slab
+         * @param ringSize  number of pixel buffer objects
+         */
+        VolumeStream(GLuint texture, glm::uvec3 res, VoxelType type, Histogram::ValueRange range, const void* voxels,
+            std::shared_ptr<const void> storage, bool count = true, std::size_t slabBytes = std::size_t(4) << 20u,
+            std::size_t ringSize = 3);
+        ~VolumeStream();
+
+        VolumeStream(const VolumeStream&) = delete;
+        VolumeStream& operator=(const VolumeStream&) = delete;
+
+        /**
+         * Fill the ring with slabs until all slabs are copied or the stream is cancelled.
+         * @return value counts of the volume, see Histogram::countValues(), or nothing if the stream was cancelled or
+         *         does not count
+         */
+        std::optional<Histogram::ValueCounts> produce();
+
+        /**
+         * Upload filled slabs and recycle consumed buffers. Never blocks.
+         * @return true if the whole volume is uploaded
+         */
+        bool upload();
+
+        /**
+         * Stop the producer and wait until it has left produce(). Buffers are released afterwards.
+         */
+        void cancel();
+
+    private:
+        enum class SlotState {
+            Free,
+            Filled,
+            InFlight,
+        };
+
+        struct Slot {
+            GLuint pbo;
+            void* ptr;
+            GLsync fence;
+            SlotState state;
+        };
+
+        void releaseBuffers();
+
+        GLuint texture_;
+        glm::uvec3 res_;
+        VoxelType type_;
+        Histogram::ValueRange range_;
+        const std::uint8_t* voxels_;
+        bool count_;
+        std::shared_ptr<const void> storage_;
+        std::size_t sliceBytes_;
+        GLuint slabDepth_;
+        std::size_t numSlabs_;
+
+        std::vector<Slot> slots_;
+        std::size_t nextUpload_; //!< render thread only
+        bool producing_;
+        bool cancelled_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+    };
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
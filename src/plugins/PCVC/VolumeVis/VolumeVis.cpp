@@ -1,25 +1,48 @@
 #include "VolumeVis.h"
 
 #include <algorithm>
-#include <fstream>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <iterator>
+#include <optional>
+#include <sstream>
 
-#include <datraw.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
 #include <imgui_stdlib.h>
 #include <glm/gtx/string_cast.hpp>
 #include <string>
-#include <tuple>
 #include <iostream>
+#include <type_traits>
 
 #include "core/Core.h"
 #include "core/util/ImGuiUtil.h"
+#include "core/util/Profiler.h"
+#include "BrickedVolume.h"
+#include "GradientVolume.h"
+#include "PreIntegratedTable.h"
+#include "RayCostMap.h"
+#include "TransferFunction.h"
+#include "VolumeFile.h"
+#include "VolumeStatistics.h"
 
 using namespace OGL4Core2;
 using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
 
+static const char* voxelTypeName(VoxelType type) {
+    switch (type) {
+        case VoxelType::UInt8:
+            return "uint8";
+        case VoxelType::UInt16:
+            return "uint16";
+        case VoxelType::Float32:
+            return "float32";
+    }
+    return "unknown";
+}
+
 /**
  * @brief VolumeVis constructor.
  */
@@ -31,17 +54,51 @@ VolumeVis::VolumeVis(const Core::Core& c)
       currentFileSelection(0),
       volumeRes(glm::uvec3(0)),
       volumeDim(glm::vec3(0.0)),
+      volumeType(VoxelType::UInt8),
+      volumeRange({0.0f, 255.0f}),
+      volumeStatistics(),
+      volumeStatisticsComplete(false),
+      volumeVoxels(nullptr),
+      volumeGeneration(0),
+      backVolumeTex(0),
+      currentTimeStep(0),
+      playing(false),
+      showNextStep(false),
+      playbackRate(10.0f),
+      prefetchSteps(4),
+      playbackStalled(false),
+      playbackStalls(0),
+      playbackStallMs(0.0),
+      forcePaging(false),
+      pagingHostBudget(1024),
+      pagingDeviceBudget(1024),
+      pagingUploadsPerFrame(32),
+      lodBias(0.0f),
       fovY(45.0f),
       backgroundColor(glm::vec3(0.2f, 0.2f, 0.2f)),
       useLinearFilter(true),
       showBox(true),
       viewMode(ViewMode::LineOfSight),
+      useSkipping(true),
+      countSamples(false),
+      takenSamples(0),
+      skippedSamples(0),
+      recordRayCost(false),
+      usePrecomputedGradients(false),
+      gradientGeneration(0),
+      gradientPending(false),
+      gradientMs(0.0),
+      gradientBenchmarkRequested(false),
+      cpuReferenceRequested(false),
+      cpuReferenceFile("volumevis_cpu.png"),
       // --------------------------------------------------------------------------------
       // TODO: Set maxSteps to reasonable default, explain here! Current value is just a placeholder.
       // --------------------------------------------------------------------------------
       maxSteps(600),
       stepSize(0.001f),
       scale(0.02f),
+      autoParameters(true),
+      autoParametersPending(false),
       isoValue(0.5f),
       ambientColor(glm::vec3(1.0f, 1.0f, 1.0f)),
       diffuseColor(glm::vec3(1.0f, 1.0f, 1.0f)),
@@ -51,6 +108,14 @@ VolumeVis::VolumeVis(const Core::Core& c)
       k_specular(0.1f),
       k_exp(120.0f),
       tfNumPoints(256),
+      tfDirtyFirst(0),
+      tfDirtyLast(0),
+      tfPaintLastX(-1),
+      tfPaintLastValue(0.0f),
+      usePreIntegration(false),
+      preIntegrationStep(0.001f),
+      preIntegratedDirtyFirst(0),
+      preIntegratedDirtyLast(0),
       editorHeight(200),
       colormapHeight(20),
       histoLogplot(false),
@@ -60,16 +125,22 @@ VolumeVis::VolumeVis(const Core::Core& c)
       histoNumBins(256),
       histoMaxBinValue(0),
       volumeTex(0),
-      tfTex(0) {
+      tfTex(0),
+      brickTex(0),
+      tfAlphaMaxTex(0),
+      gradientTex(0),
+      preIntegratedTex(0),
+      sampleCountBuffer(0) {
     // Init Camera
     camera = std::make_shared<Core::OrbitCamera>(2.0f);
     core_.registerCamera(camera);
 
     // Load list of data files.
-    datFiles = getResourceDirFilePaths("volumes", "^.*\\.dat$");
+    datFiles = getResourceDirFilePaths("volumes", "^.*\\.(dat|bvol)$");
     datFilesGuiString.clear();
     for (const auto& file : datFiles) {
-        datFilesGuiString += file.stem().string() + '\0';
+        // Keep the extension of converted volumes, they usually lie next to their dat file.
+        datFilesGuiString += (file.extension() == ".dat" ? file.stem() : file.filename()).string() + '\0';
     }
     datFilesGuiString += '\0';
 
@@ -77,6 +148,11 @@ VolumeVis::VolumeVis(const Core::Core& c)
     initShaders();
     initVAs();
 
+    glGenBuffers(1, &sampleCountBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sampleCountBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
     // Load the volume file and its transfer function
     loadVolumeFile(0);
     loadTransferFunc("engine.tf");
@@ -97,8 +173,20 @@ VolumeVis::~VolumeVis() {
     // --------------------------------------------------------------------------------
     //  TODO: Do not forget to clear all allocated sources.
     // --------------------------------------------------------------------------------
+    if (volumeStream != nullptr) {
+        volumeStream->cancel();
+    }
+    pagedVolume = nullptr;
+    timeSeries = nullptr;
+    rayCostMap = nullptr;
     glDeleteTextures(1, &volumeTex);
+    glDeleteTextures(1, &backVolumeTex);
     glDeleteTextures(1, &tfTex);
+    glDeleteTextures(1, &brickTex);
+    glDeleteTextures(1, &tfAlphaMaxTex);
+    glDeleteTextures(1, &gradientTex);
+    glDeleteTextures(1, &preIntegratedTex);
+    glDeleteBuffers(1, &sampleCountBuffer);
     // Reset OpenGL state.
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
@@ -120,6 +208,40 @@ void VolumeVis::renderGUI() {
         ImGui::Text("ResX: %i", volumeRes.x);
         ImGui::Text("ResY: %i", volumeRes.y);
         ImGui::Text("ResZ: %i", volumeRes.z);
+        ImGui::Text("Type: %s", voxelTypeName(volumeType));
+        ImGui::Text("Range: [%g, %g]", volumeRange.min, volumeRange.max);
+        if (ImGui::TreeNode("Statistics")) {
+            // Values are normalized to the range, like isoValue.
+            const auto& stats = volumeStatistics;
+            ImGui::Text("Min: %.4f, max: %.4f", stats.moments.min, stats.moments.max);
+            ImGui::Text("Mean: %.4f, std. dev.: %.4f", stats.moments.mean, std::sqrt(stats.moments.variance));
+            if (volumeStatisticsComplete) {
+                ImGui::Text("Percentiles: 1%% %.4f, 50%% %.4f, 99%% %.4f", stats.percentile(0.01),
+                    stats.percentile(0.5), stats.percentile(0.99));
+            } else {
+                ImGui::TextUnformatted("Percentiles: counting...");
+            }
+            ImGui::Text("Content: [%u, %u, %u] - [%u, %u, %u]", stats.boundsMin.x, stats.boundsMin.y, stats.boundsMin.z,
+                stats.boundsMax.x, stats.boundsMax.y, stats.boundsMax.z);
+            ImGui::Checkbox("Auto parameters", &autoParameters);
+            ImGui::SameLine();
+            ImGui::BeginDisabled(!volumeStatisticsComplete);
+            if (ImGui::Button("Apply")) {
+                applyAutoParameters();
+            }
+            ImGui::EndDisabled();
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Histogram Benchmark")) {
+            if (ImGui::Button("Run") && volumeVoxels != nullptr) {
+                runHistogramBenchmark();
+            }
+            for (const auto& result : histoBenchmark) {
+                ImGui::Text("%2u threads: %8.2f ms, %7.1f MVoxel/s", result.numThreads, result.ms,
+                    result.voxelsPerSecond / 1.0e6);
+            }
+            ImGui::TreePop();
+        }
         // Whether to use linear filtering
         ImGui::Checkbox("Lin. Filter", &useLinearFilter);
         ImGui::Checkbox("ShowBox", &showBox);
@@ -131,15 +253,107 @@ void VolumeVis::renderGUI() {
                 {ViewMode::Volume, "Volume"},
                 {ViewMode::Noise, "Noise"},
             });
-        ImGui::InputInt("MaxSteps", &maxSteps);
+        ImGui::Checkbox("Empty-space skipping", &useSkipping);
+        ImGui::Checkbox("Count samples", &countSamples);
+        if (countSamples) {
+            const uint64_t totalSamples = takenSamples + skippedSamples;
+            ImGui::Text("Skipped samples: %.1f%% (%llu of %llu)",
+                totalSamples > 0 ? 100.0 * static_cast<double>(skippedSamples) / static_cast<double>(totalSamples) : 0.0,
+                static_cast<unsigned long long>(skippedSamples), static_cast<unsigned long long>(totalSamples));
+        }
+        if (ImGui::TreeNode("Ray Cost")) {
+            ImGui::Checkbox("Record", &recordRayCost);
+            if (rayCostMap != nullptr) {
+                const auto& stats = rayCostMap->statistics();
+                ImGui::Text("Rays: %llu, mean steps: %.1f", static_cast<unsigned long long>(stats.rays),
+                    stats.meanSteps());
+                ImGui::Text("Steps: median %u, 95%% %u, max %u", stats.medianSteps, stats.p95Steps, stats.maxSteps);
+                ImGui::Text("Left volume: %.1f%%", 100.0 * stats.fraction(RayCostMap::Termination::LeftVolume));
+                ImGui::Text("Reached MaxSteps: %.1f%%", 100.0 * stats.fraction(RayCostMap::Termination::MaxSteps));
+                ImGui::Text("Hit surface: %.1f%%", 100.0 * stats.fraction(RayCostMap::Termination::Surface));
+                // Steps relative to MaxSteps from black to yellow, rays which reached MaxSteps are white.
+                const glm::ivec2 size = rayCostMap->heatmapSize();
+                if (size.x > 0 && size.y > 0) {
+                    const float width = ImGui::GetContentRegionAvail().x;
+                    ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(rayCostMap->heatmapTexture())),
+                        ImVec2(width, width * static_cast<float>(size.y) / static_cast<float>(size.x)), ImVec2(0, 1),
+                        ImVec2(1, 0));
+                }
+            }
+            ImGui::TreePop();
+        }
+        if (timeSeries != nullptr && ImGui::TreeNode("Time Series")) {
+            if (ImGui::Button(playing ? "Pause" : "Play")) {
+                playing = !playing;
+                lastStepTime = std::chrono::steady_clock::now();
+            }
+            ImGui::SliderFloat("Steps/s", &playbackRate, 1.0f, 60.0f);
+            int step = static_cast<int>(currentTimeStep);
+            if (ImGui::SliderInt("Time step", &step, 0, static_cast<int>(timeSeries->numSteps()) - 1)) {
+                timeSeries->seek(static_cast<std::size_t>(step));
+                showNextStep = true;
+            }
+            ImGui::InputInt("Prefetch steps", &prefetchSteps);
+            prefetchSteps = std::clamp(prefetchSteps, 1, 64);
+            ImGui::Text("Prefetched: %zu", timeSeries->prefetched());
+            ImGui::Text("Stalls: %zu, waited %.1f ms%s", playbackStalls, playbackStallMs,
+                playbackStalled ? " (stalled)" : "");
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Out-of-core")) {
+            // Reloads the current volume, paged or resident.
+            if (ImGui::Checkbox("Force paging", &forcePaging)) {
+                loadVolumeFile(currentFileLoaded);
+            }
+            if (ImGui::InputInt("Host budget (MiB)", &pagingHostBudget, 64)) {
+                pagingHostBudget = std::max(pagingHostBudget, 16);
+                if (pagedVolume != nullptr) {
+                    pagedVolume->setHostBudget(static_cast<std::size_t>(pagingHostBudget) << 20u);
+                }
+            }
+            // The atlas is allocated on load, so this applies to the next loaded volume.
+            ImGui::InputInt("Atlas budget (MiB)", &pagingDeviceBudget, 64);
+            pagingDeviceBudget = std::max(pagingDeviceBudget, 16);
+            if (ImGui::SliderInt("Uploads per frame", &pagingUploadsPerFrame, 1, 256) && pagedVolume != nullptr) {
+                pagedVolume->setUploadsPerFrame(static_cast<std::size_t>(pagingUploadsPerFrame));
+            }
+            ImGui::SliderFloat("LOD bias", &lodBias, -2.0f, 4.0f);
+            if (pagedVolume != nullptr) {
+                const auto stats = pagedVolume->statistics();
+                ImGui::Text("Resident bricks: %zu of %zu", stats.residentBricks, stats.numSlots);
+                ImGui::Text("Requested: %zu%s, pending: %zu, uploaded: %zu", stats.requestedBricks,
+                    stats.requestsOverflowed ? "+" : "", stats.pendingBricks, stats.uploadedBricks);
+                ImGui::Text("Brick cache: %.1f MiB, %zu hits, %zu misses",
+                    static_cast<double>(stats.cacheSize) / (1024.0 * 1024.0), stats.cacheHits, stats.cacheMisses);
+            } else {
+                ImGui::TextUnformatted("Not paged");
+            }
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("CPU Reference")) {
+            ImGui::InputText("File", &cpuReferenceFile);
+            if (ImGui::Button("Render") && volumeVoxels != nullptr) {
+                cpuReferenceRequested = true;
+            }
+            ImGui::TextUnformatted(cpuReferenceSummary.c_str());
+            ImGui::TreePop();
+        }
+        // Edits win over the auto parameters of a volume which is still loading.
+        if (ImGui::InputInt("MaxSteps", &maxSteps)) {
+            autoParametersPending = false;
+        }
         maxSteps = std::clamp(maxSteps, 1, 10000);
         ImGui::InputFloat("StepSize", &stepSize, 0.005f);
         stepSize = std::clamp(stepSize, 0.0f, 1.0f);
         if (viewMode != ViewMode::Isosurface) {
-            ImGui::InputFloat("Scale", &scale, 0.1f);
+            if (ImGui::InputFloat("Scale", &scale, 0.1f)) {
+                autoParametersPending = false;
+            }
         }
         if (viewMode == ViewMode::Isosurface) {
-            ImGui::InputFloat("IsoValue", &isoValue, 0.01f);
+            if (ImGui::InputFloat("IsoValue", &isoValue, 0.01f)) {
+                autoParametersPending = false;
+            }
             isoValue = std::clamp(isoValue, 0.0f, 100.0f);
             ImGui::ColorEdit3("Ambient", reinterpret_cast<float*>(&ambientColor), ImGuiColorEditFlags_Float);
             ImGui::ColorEdit3("Diffuse", reinterpret_cast<float*>(&diffuseColor), ImGuiColorEditFlags_Float);
@@ -148,11 +362,34 @@ void VolumeVis::renderGUI() {
             ImGui::SliderFloat("k_diff", &k_diffuse, 0.0f, 1.0f);
             ImGui::SliderFloat("k_spec", &k_specular, 0.0f, 1.0f);
             ImGui::SliderFloat("k_exp", &k_exp, 0.0f, 5000.0f);
+            ImGui::Checkbox("Precomputed gradients", &usePrecomputedGradients);
+            if (usePrecomputedGradients) {
+                if (volumeVoxels != nullptr && gradientGeneration == volumeGeneration) {
+                    ImGui::Text("Computed in %.1f ms", gradientMs);
+                } else {
+                    ImGui::TextUnformatted(volumeVoxels != nullptr ? "Computing..." : "Not available");
+                }
+            }
+            if (ImGui::TreeNode("Gradient Benchmark")) {
+                if (ImGui::Button("Run") && volumeVoxels != nullptr && gradientGeneration == volumeGeneration) {
+                    gradientBenchmarkRequested = true;
+                }
+                for (const auto& timing : gradientBenchmark) {
+                    ImGui::Text("step %.4f: on-the-fly %7.3f ms, precomputed %7.3f ms", timing.stepSize,
+                        timing.onTheFlyMs, timing.precomputedMs);
+                }
+                ImGui::TreePop();
+            }
         }
         if (viewMode == ViewMode::Volume) {
             ImGui::SliderInt("editor height", &editorHeight, 0, 500);
             ImGui::Checkbox("LogPlot", &histoLogplot);
             ImGui::Checkbox("random offset", &useRandom);
+            ImGui::Checkbox("Pre-integration", &usePreIntegration);
+            if (usePreIntegration) {
+                ImGui::InputFloat("Reference step", &preIntegrationStep, 0.0005f, 0.0f, "%.4f");
+                preIntegrationStep = std::clamp(preIntegrationStep, 0.0001f, 1.0f);
+            }
             ImGui::Combo("TF channel", &tfChannel, "red\0green\0blue\0alpha\0");
             ImGui::InputText("TF filename", &tfFilename);
         }
@@ -168,17 +405,23 @@ void VolumeVis::renderGUI() {
  * @brief VolumeVis render callback.
  */
 void VolumeVis::render() {
+    Core::Profiler::GpuZone profilerZone("VolumeVis::render");
     renderGUI();
+    advanceTimeSeries();
+    updateGradients();
+    uploadTransferFunc();
 
     glClearColor(backgroundColor.r, backgroundColor.g, backgroundColor.b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     float viewAspect = 1.0f;
+    glm::ivec4 volumeViewport(0, 0, wWidth, wHeight);
     if (viewMode == ViewMode::Volume) {
         // --------------------------------------------------------------------------------
         //  TODO: Set the viewport and viewAspect.
         // --------------------------------------------------------------------------------
         float volumeWHeight = wHeight - editorHeight;
+        volumeViewport = glm::ivec4(0, editorHeight, wWidth, volumeWHeight);
         glViewport(0, editorHeight, wWidth, volumeWHeight);
         viewAspect = static_cast<float>(wWidth) / static_cast<float>(volumeWHeight);
     } else {
@@ -199,6 +442,18 @@ void VolumeVis::render() {
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_1D, tfTex);
     shaderVolume->setUniform("transferTex", 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, brickTex);
+    shaderVolume->setUniform("brickTex", 2);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, tfAlphaMaxTex);
+    shaderVolume->setUniform("tfAlphaMaxTex", 3);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, gradientTex);
+    shaderVolume->setUniform("gradientTex", 5);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, preIntegratedTex);
+    shaderVolume->setUniform("preIntegratedTex", 6);
 
     glm::mat4 projMx = glm::perspective(glm::radians(fovY), viewAspect, 1.0f, 50.0f);
     shaderVolume->setUniform("orthoProjMx", orthoProjMx);
@@ -207,10 +462,17 @@ void VolumeVis::render() {
 
     shaderVolume->setUniform("volumeRes", (glm::vec3)volumeRes);
     shaderVolume->setUniform("volumeDim", volumeDim);
+    const glm::vec2 mapping = valueMapping();
+    shaderVolume->setUniform("valueScale", mapping.x);
+    shaderVolume->setUniform("valueOffset", mapping.y);
 
     shaderVolume->setUniform("viewMode", (int)viewMode);
     shaderVolume->setUniform("showBox", showBox);
     shaderVolume->setUniform("useRandom", useRandom);
+    // The brick grid needs the full resolution volume, which a paged volume does not have.
+    shaderVolume->setUniform("useSkipping", useSkipping && pagedVolume == nullptr);
+    shaderVolume->setUniform("brickSize", static_cast<int>(BrickGrid::brickSize));
+    shaderVolume->setUniform("countSamples", countSamples);
     
 
     shaderVolume->setUniform("maxSteps", maxSteps);
@@ -226,16 +488,88 @@ void VolumeVis::render() {
     shaderVolume->setUniform("k_diff", k_diffuse);
     shaderVolume->setUniform("k_spec", k_specular);
     shaderVolume->setUniform("k_exp", k_exp);
+    // Gradients of another volume or time step are not used.
+    const bool gradientsValid = volumeVoxels != nullptr && gradientGeneration == volumeGeneration;
+    shaderVolume->setUniform("usePrecomputedGradients", usePrecomputedGradients && gradientsValid);
+    shaderVolume->setUniform("usePreIntegration", usePreIntegration);
+    shaderVolume->setUniform("preIntegrationStep", preIntegrationStep);
     
+    shaderVolume->setUniform("usePaging", pagedVolume != nullptr);
+    if (pagedVolume != nullptr) {
+        pagedVolume->bind(*shaderVolume, 4);
+        // A pixel covers 2 * tan(fovY / 2) / height world units at distance 1.
+        const float voxelSize = volumeDim.x / static_cast<float>(volumeRes.x);
+        const float pixelSize = 2.0f * std::tan(glm::radians(fovY) / 2.0f) / static_cast<float>(volumeViewport.w);
+        shaderVolume->setUniform("lodScale", pixelSize / voxelSize);
+        shaderVolume->setUniform("lodBias", lodBias);
+    }
+
     shaderVolume->setUniform("width", wWidth);
     shaderVolume->setUniform("height", wHeight);
     // int t = static_cast<int> (time(NULL));
 
+    if (recordRayCost) {
+        if (rayCostMap == nullptr) {
+            rayCostMap = std::make_unique<RayCostMap>();
+        }
+        rayCostMap->bind(*shaderVolume, wWidth, wHeight);
+    } else {
+        rayCostMap = nullptr;
+        shaderVolume->setUniform("recordCost", false);
+    }
+
+    const GLuint zeroCounts[2] = {0, 0};
+    if (countSamples) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sampleCountBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeroCounts), zeroCounts);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sampleCountBuffer);
+    }
+
+    if (gradientBenchmarkRequested) {
+        gradientBenchmarkRequested = false;
+        if (gradientsValid) {
+            runGradientBenchmark();
+        }
+    }
+
     vaQuad->draw();
     glUseProgram(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    if (pagedVolume != nullptr) {
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_3D, 0);
+        pagedVolume->update();
+    }
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_3D, 0);
 
+    if (countSamples) {
+        // Waits for the volume pass, the counts are only read while they are shown.
+        GLuint counts[2] = {0, 0};
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        takenSamples = counts[0];
+        skippedSamples = counts[1];
+    }
+
+    if (rayCostMap != nullptr) {
+        rayCostMap->update(volumeViewport, maxSteps);
+    }
+
+    if (cpuReferenceRequested) {
+        cpuReferenceRequested = false;
+        runCpuReference(volumeViewport, projMx);
+    }
+
     if (viewMode == ViewMode::Volume) {
+        Core::Profiler::GpuZone editorZone("VolumeVis::transferFunctionEditor");
         // --------------------------------------------------------------------------------
         //  TODO: Draw the transfer-function editor and histogram.
         // --------------------------------------------------------------------------------
@@ -309,6 +643,12 @@ void VolumeVis::keyboard(Core::Key key, Core::KeyAction action, [[maybe_unused]]
             initShaders();
             break;
         }
+        case Core::Key::Space: {
+            // toggle time series playback
+            playing = !playing;
+            lastStepTime = std::chrono::steady_clock::now();
+            break;
+        }
         case Core::Key::Key1: {
             viewMode = ViewMode::LineOfSight;
             break;
@@ -388,12 +728,26 @@ void VolumeVis::mouseMove(double xpos, double ypos) {
         float y = ((wHeight - ypos)/editorHeight-0.1)/0.9;
 
         if (x>255) x = 255;
+        if (x < 0) x = 0;
         if (y > 1.0) y = 1.0;
         if (y < 0.0) y = 0.0;
 
+        // Cursor events are merged to one per frame, so a fast drag skips entries. Fill the line from the previously
+        // painted entry, the dirty range then covers all of them in a single upload.
+        if (tfPaintLastX >= 0 && tfPaintLastX != x) {
+            const int step = x > tfPaintLastX ? 1 : -1;
+            const auto span = static_cast<float>(x - tfPaintLastX);
+            for (int i = tfPaintLastX + step; i != x; i += step) {
+                const float t = static_cast<float>(i - tfPaintLastX) / span;
+                updateTransferFunc(i, tfChannel, tfPaintLastValue + t * (y - tfPaintLastValue));
+            }
+        }
         // std::cout << x << " " << y << std::endl;
         updateTransferFunc(x, tfChannel, y);
-
+        tfPaintLastX = x;
+        tfPaintLastValue = y;
+    } else {
+        tfPaintLastX = -1;
     }
 }
 
@@ -403,46 +757,46 @@ void VolumeVis::mouseMove(double xpos, double ypos) {
 void VolumeVis::initShaders() {
     // Initialize shader for volume
     try {
-        shaderVolume = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/volume.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/volume.frag")}});
+        createShaderProgram(shaderVolume, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/volume.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/volume.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for background
     try {
-        shaderBackground = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/background.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/background.frag")}});
+        createShaderProgram(shaderBackground, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/background.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/background.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for histogram
     try {
-        shaderHisto = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/histo.vert")},
-            {glowl::GLSLProgram::ShaderType::Geometry, getStringResource("shaders/histo.geom")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/histo.frag")}});
+        createShaderProgram(shaderHisto, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/histo.vert"},
+            {glowl::GLSLProgram::ShaderType::Geometry, "shaders/histo.geom"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/histo.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for transfer function lines
     try {
-        shaderTfLines = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/tf-lines.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/tf-lines.frag")}});
+        createShaderProgram(shaderTfLines, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/tf-lines.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/tf-lines.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
 
     // Initialize shader for transfer function preview
     try {
-        shaderTfView = std::make_unique<glowl::GLSLProgram>(glowl::GLSLProgram::ShaderSourceList{
-            {glowl::GLSLProgram::ShaderType::Vertex, getStringResource("shaders/tf-view.vert")},
-            {glowl::GLSLProgram::ShaderType::Fragment, getStringResource("shaders/tf-view.frag")}});
+        createShaderProgram(shaderTfView, {
+            {glowl::GLSLProgram::ShaderType::Vertex, "shaders/tf-view.vert"},
+            {glowl::GLSLProgram::ShaderType::Fragment, "shaders/tf-view.frag"}});
     } catch (glowl::GLSLProgramException& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -469,6 +823,9 @@ void VolumeVis::initVAs() {
 
 /**
  * @brief Load volume file.
+ * The file is read and the value range is calculated on a worker thread. The volume texture is allocated afterwards on
+ * the render thread in the format of the voxel type and filled with slabs of slices over multiple frames, while the
+ * histogram is counted. Large bricked volumes are paged instead, see PagedVolume.
  * @param idx   The file index
  */
 void VolumeVis::loadVolumeFile(int idx) {
@@ -476,6 +833,7 @@ void VolumeVis::loadVolumeFile(int idx) {
         throw std::runtime_error("Invalid file index!");
     }
     currentFileLoaded = idx;
+    autoParametersPending = true;
 
     std::string volumeFile = datFiles[idx].string();
 
@@ -486,62 +844,593 @@ void VolumeVis::loadVolumeFile(int idx) {
     //        Calculate the histogram. Upload the volume as a 3D texture.
     // --------------------------------------------------------------------------------
 
-    datraw::raw_reader<char> rd = datraw::raw_reader<char>::open(volumeFile);
-    std::vector<datraw::uint8> raw = rd.read_current();
-    volumeRes = glm::uvec3(rd.info().resolution()[0], rd.info().resolution()[1], rd.info().resolution()[2]);
-    // std::cout << glm::to_string(volumeRes) << std::endl;
-    float max = std::max(std::max(volumeRes.x, volumeRes.y), volumeRes.z);
-    volumeDim = glm::vec3(volumeRes.x / max, volumeRes.y / max, volumeRes.z / max);
-    // std::cout << glm::to_string(volumeDim) << std::endl;
+    // Stop streaming of the previous volume, its texture is replaced.
+    if (volumeStream != nullptr) {
+        volumeStream->cancel();
+        volumeStream = nullptr;
+    }
 
-    glGenTextures(1, &volumeTex);
-    glBindTexture(GL_TEXTURE_3D, volumeTex);
+    struct VolumeData {
+        glm::uvec3 res;
+        VoxelType type;
+        VolumeStatistics stats;              //!< Counts are only set for paged or cached volumes.
+        std::shared_ptr<const void> storage; //!< Keeps either the memory mapping or the read buffer alive.
+        const void* voxels;
+        std::shared_ptr<const BrickedVolume> paged; //!< Set if the volume is rendered out-of-core.
+        bool cached;                                //!< The statistics were read from the cache.
+        std::uint64_t cacheKey;                     //!< Key of the statistics cache.
+        std::size_t numTimeSteps;
+    };
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxTextureSize);
+    const bool paging = forcePaging;
+    const std::size_t deviceBudget = static_cast<std::size_t>(pagingDeviceBudget) << 20u;
+
+    loadResourceAsync<VolumeData>(
+        [volumeFile, paging, deviceBudget, maxTextureSize]() {
+            // Bricked volumes with a level pyramid are paged if they do not fit into the atlas budget or a texture.
+            if (std::filesystem::path(volumeFile).extension() == ".bvol") {
+                auto bricked = std::make_shared<const BrickedVolume>(volumeFile);
+                const glm::uvec3 res = bricked->res();
+                const std::size_t numBytes =
+                    static_cast<std::size_t>(res.x) * res.y * res.z * voxelSize(bricked->type());
+                const unsigned int maxRes = std::max(std::max(res.x, res.y), res.z);
+                if (bricked->numLevels() > 1 &&
+                    (paging || numBytes > deviceBudget || maxRes > static_cast<unsigned int>(maxTextureSize))) {
+                    VolumeData data;
+                    data.res = res;
+                    data.type = bricked->type();
+                    data.voxels = nullptr;
+                    data.paged = bricked;
+                    data.cached = false;
+                    data.cacheKey = 0;
+                    data.numTimeSteps = 1;
+                    // Statistics of the finest level which is cheap to decode. The bounds are scaled to level 0, the
+                    // brick grid and moments are left out because paged volumes have no brick grid.
+                    constexpr std::size_t maxStatisticsVoxels = std::size_t(1) << 24u;
+                    unsigned int level = 0;
+                    auto numVoxels = [&](unsigned int l) {
+                        return static_cast<std::size_t>(bricked->res(l).x) * bricked->res(l).y * bricked->res(l).z;
+                    };
+                    while (level + 1 < bricked->numLevels() && numVoxels(level) > maxStatisticsVoxels) {
+                        level++;
+                    }
+                    const auto levelVoxels = bricked->decodeLevel(level);
+                    dispatchVoxelType(data.type, [&](auto traits) {
+                        using T = typename decltype(traits)::Scalar;
+                        const T* voxels = reinterpret_cast<const T*>(levelVoxels->data());
+                        if constexpr (std::is_same_v<T, std::uint8_t>) {
+                            data.stats.range = {0.0f, 255.0f};
+                        } else {
+                            data.stats.range = Histogram::valueRange(voxels, numVoxels(level));
+                        }
+                        data.stats.counts = Histogram::countValues(voxels, numVoxels(level), data.stats.range);
+                        data.stats.compute(voxels, bricked->res(level));
+                    });
+                    data.stats.bricks = BrickGrid();
+                    data.stats.brickMoments.clear();
+                    const glm::uvec3 levelRes = bricked->res(level);
+                    for (int i = 0; i < 3; i++) {
+                        data.stats.boundsMin[i] = static_cast<unsigned int>(
+                            static_cast<std::uint64_t>(data.stats.boundsMin[i]) * res[i] / levelRes[i]);
+                        data.stats.boundsMax[i] = static_cast<unsigned int>(
+                            (static_cast<std::uint64_t>(data.stats.boundsMax[i]) * res[i] + levelRes[i] - 1) /
+                            levelRes[i]);
+                    }
+                    return data;
+                }
+            }
+
+            // Uncompressed raw files are mapped and read slab by slab while streaming, everything else is read
+            // completely. Bricked volumes are decoded in parallel.
+            VolumeFile file = VolumeFile::read(volumeFile);
+            VolumeData data;
+            data.res = file.res;
+            data.type = file.type;
+            data.storage = std::move(file.storage);
+            data.voxels = file.voxels;
+            data.numTimeSteps = file.numTimeSteps;
+            const std::filesystem::path dataFile = std::move(file.dataFile);
+            const std::size_t numVoxels = static_cast<std::size_t>(data.res.x) * data.res.y * data.res.z;
+
+            // Statistics of a volume opened before are read from its cache, which skips the pass over the voxels.
+            data.cacheKey = VolumeStatistics::cacheKey(dataFile, data.voxels, data.res, data.type);
+            auto cached =
+                VolumeStatistics::load(VolumeStatistics::cachePath(volumeFile), data.cacheKey, data.res, data.type);
+            data.cached = cached.has_value();
+            if (cached) {
+                data.stats = std::move(*cached);
+                return data;
+            }
+
+            // 8 bit volumes use the full range of the type, like before. Other types usually cover only a part of
+            // their range (e.g. 12 bit CT data), so the transfer function is spread over the actual values.
+            dispatchVoxelType(data.type, [&](auto traits) {
+                using T = typename decltype(traits)::Scalar;
+                const T* voxels = static_cast<const T*>(data.voxels);
+                if constexpr (std::is_same_v<T, std::uint8_t>) {
+                    data.stats.range = {0.0f, 255.0f};
+                } else {
+                    data.stats.range = Histogram::valueRange(voxels, numVoxels);
+                }
+                data.stats.compute(voxels, data.res);
+            });
+            return data;
+        },
+        [this, volumeFile](VolumeData& data) {
+            volumeRes = data.res;
+            volumeType = data.type;
+            volumeRange = data.stats.range;
+            float max = std::max(std::max(volumeRes.x, volumeRes.y), volumeRes.z);
+            volumeDim = glm::vec3(volumeRes.x / max, volumeRes.y / max, volumeRes.z / max);
+            pagedVolume = nullptr;
+            timeSeries = nullptr;
+            glDeleteTextures(1, &backVolumeTex);
+            backVolumeTex = 0;
+            currentTimeStep = 0;
+            playing = false;
+            showNextStep = false;
+            playbackStalled = false;
+            playbackStalls = 0;
+            playbackStallMs = 0.0;
+
+            if (data.paged != nullptr) {
+                // No full resolution copy exists, on the CPU nor on the GPU.
+                glDeleteTextures(1, &volumeTex);
+                volumeTex = 0;
+                volumeStorage = nullptr;
+                volumeVoxels = nullptr;
+                volumeGeneration++;
+                initBrickGrid(BrickGrid());
+                volumeStatistics = data.stats;
+                initStatistics(data.stats.counts);
+                try {
+                    pagedVolume = std::make_unique<PagedVolume>(data.paged,
+                        static_cast<std::size_t>(pagingHostBudget) << 20u,
+                        static_cast<std::size_t>(pagingDeviceBudget) << 20u,
+                        static_cast<std::size_t>(pagingUploadsPerFrame));
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                }
+                return;
+            }
+
+            glDeleteTextures(1, &volumeTex);
+            volumeTex = createVolumeTexture();
+
+            volumeStorage = data.storage;
+            volumeVoxels = data.voxels;
+            volumeGeneration++;
+            initBrickGrid(data.stats.bricks);
+            volumeStatistics = data.stats;
+
+            // A worker fills the pixel buffer ring and counts the histogram unless it is cached, uploads happen once
+            // per frame. The producer also runs for cached volumes, it is the only one filling the ring. Complete
+            // counts are written to the cache together with the other statistics.
+            auto stream = std::make_shared<VolumeStream>(volumeTex, volumeRes, volumeType, volumeRange, data.voxels,
+                data.storage, !data.cached);
+            volumeStream = stream;
+            if (data.cached) {
+                initStatistics(data.stats.counts);
+            } else {
+                volumeStatisticsComplete = false;
+            }
+            loadResourceAsync<std::optional<Histogram::ValueCounts>>(
+                [stream, stats = std::move(data.stats), volumeFile, key = data.cacheKey, res = volumeRes,
+                    type = volumeType]() mutable {
+                    // Without counting, i.e. for cached statistics, produce() returns nothing.
+                    auto counts = stream->produce();
+                    if (counts) {
+                        stats.counts = *counts;
+                        try {
+                            stats.store(VolumeStatistics::cachePath(volumeFile), key, res, type);
+                        } catch (const std::exception& e) {
+                            std::cerr << e.what() << std::endl;
+                        }
+                    }
+                    return counts;
+                },
+                [this, stream](std::optional<Histogram::ValueCounts>& counts) {
+                    if (counts && stream == volumeStream) {
+                        initStatistics(*counts);
+                    }
+                });
+            uploadResourceAsync([stream]() { return stream->upload(); });
+
+            // The first step is streamed like a single volume, the following ones are prefetched for playback.
+            if (data.numTimeSteps > 1) {
+                timeSeries = std::make_unique<TimeSeries>(volumeFile, volumeType, volumeRes, volumeRange,
+                    data.numTimeSteps, 1, static_cast<std::size_t>(prefetchSteps));
+            }
+        });
+}
+
+/**
+ * @brief Allocate a 3D texture in the size and format of the current volume.
+ * @return The texture handle
+ */
+GLuint VolumeVis::createVolumeTexture() const {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RED, rd.info().resolution()[0], rd.info().resolution()[1], rd.info().resolution()[2], 0, GL_RED, GL_UNSIGNED_BYTE, &raw[0]);
+    dispatchVoxelType(volumeType, [this](auto traits) {
+        glTexImage3D(GL_TEXTURE_3D, 0, traits.internalFormat, volumeRes.x, volumeRes.y, volumeRes.z, 0, GL_RED,
+            traits.glType, nullptr);
+    });
     glBindTexture(GL_TEXTURE_3D, 0);
+    return texture;
+}
+
+/**
+ * @brief Show the next time step of a time series when it is due.
+ * The step is uploaded into the back texture, which is swapped with the volume texture afterwards. A step which is
+ * due but not prefetched yet counts as stall, playback continues once it arrives.
+ */
+void VolumeVis::advanceTimeSeries() {
+    if (timeSeries == nullptr || (!playing && !showNextStep)) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (!showNextStep && now - lastStepTime < std::chrono::duration<double>(1.0 / playbackRate)) {
+        return;
+    }
+
+    TimeSeries::Step step;
+    if (!timeSeries->tryPop(step)) {
+        if (playing && !playbackStalled) {
+            playbackStalled = true;
+            stallStart = now;
+            playbackStalls++;
+            std::cerr << "Time series playback stalled: step " << (currentTimeStep + 1) % timeSeries->numSteps()
+                      << " is not prefetched yet." << std::endl;
+        }
+        return;
+    }
+    if (playbackStalled) {
+        playbackStalled = false;
+        playbackStallMs += std::chrono::duration<double, std::milli>(now - stallStart).count();
+    }
 
-    genHistogram(histoNumBins, raw);
+    if (backVolumeTex == 0) {
+        backVolumeTex = createVolumeTexture();
+    }
+    glBindTexture(GL_TEXTURE_3D, backVolumeTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    dispatchVoxelType(volumeType, [&](auto traits) {
+        glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, volumeRes.x, volumeRes.y, volumeRes.z, GL_RED, traits.glType,
+            step.voxels->data());
+    });
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    std::swap(volumeTex, backVolumeTex);
+
+    initBrickGrid(step.bricks);
+    volumeStorage = step.voxels;
+    volumeVoxels = step.voxels->data();
+    volumeGeneration++;
+    currentTimeStep = step.index;
+    lastStepTime = now;
+    showNextStep = false;
 }
 
 /**
- * @brief Create the histogram.
- * @param bins     The number of bins
- * @param values   The vector with the histogram values
+ * @brief Compute the gradient texture of the current volume on a worker thread when it is missing.
+ * During playback the steps change faster than the gradients can be computed, so the shader keeps its on-the-fly
+ * gradients until playback stops.
  */
-void VolumeVis::genHistogram(std::size_t bins, const std::vector<std::uint8_t>& values) {
-    if (bins == 0 || values.empty()) {
+void VolumeVis::updateGradients() {
+    if (!usePrecomputedGradients || volumeVoxels == nullptr || gradientGeneration == volumeGeneration ||
+        gradientPending || playing) {
         return;
     }
-    // --------------------------------------------------------------------------------
-    //  TODO: Calculate the histogram and init the vertex array. Values are uint8,
-    //        therefore the value range is [0, 255].
-    //        Divide this value range into "bins" number of bins.
-    // --------------------------------------------------------------------------------
-    float* histogramValueArray = new float[bins]{0};
-    for (int i = 0; i < values.size(); i++) {
-        if (bins <=256) {
-            histogramValueArray[(int)round(values[i]/255.0f*(bins-1))] += 1.0f;
-        }else{
-            uint v = values[i];
-            int a = ceil( (bins-1)/255.0f*(v-0.5));
-            int b = floor((bins-1)/255.0f*(v+0.5));
-            for (int j = a; j <= b; j++)
-            {
-                if (j >=0 && j<bins){
-                    histogramValueArray[j] += 1.0f;
-                }
+    struct Gradients {
+        std::vector<std::uint8_t> texels;
+        double ms;
+    };
+
+    gradientPending = true;
+    const void* voxels = volumeVoxels;
+    const std::uint64_t generation = volumeGeneration;
+    const VoxelType type = volumeType;
+    const glm::uvec3 res = volumeRes;
+    const Histogram::ValueRange range = volumeRange;
+    loadResourceAsync<Gradients>(
+        [storage = volumeStorage, voxels, type, res, range]() {
+            const auto start = std::chrono::high_resolution_clock::now();
+            Gradients gradients;
+            gradients.texels = dispatchVoxelType(type, [&](auto traits) {
+                using T = typename decltype(traits)::Scalar;
+                return GradientVolume::compute(static_cast<const T*>(voxels), res, range);
+            });
+            gradients.ms =
+                std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            return gradients;
+        },
+        [this, generation, res](Gradients& gradients) {
+            gradientPending = false;
+            // The volume changed while computing.
+            if (generation != volumeGeneration) {
+                return;
+            }
+            if (gradientTex == 0) {
+                glGenTextures(1, &gradientTex);
             }
-            
+            glBindTexture(GL_TEXTURE_3D, gradientTex);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, static_cast<GLsizei>(res.x), static_cast<GLsizei>(res.y),
+                static_cast<GLsizei>(res.z), 0, GL_RGBA, GL_UNSIGNED_BYTE, gradients.texels.data());
+            glBindTexture(GL_TEXTURE_3D, 0);
+            gradientGeneration = generation;
+            gradientMs = gradients.ms;
+            std::cout << "Gradients computed in " << gradientMs << " ms" << std::endl;
+        });
+}
+
+/**
+ * @brief Compare the GPU time of the isosurface pass with on-the-fly and precomputed gradients.
+ * The volume shader must be bound with all other uniforms set. Each variant is drawn several times per step size and
+ * timed with timestamp queries, which waits for the GPU. The framebuffer is cleared afterwards.
+ */
+void VolumeVis::runGradientBenchmark() {
+    constexpr int numDraws = 10;
+    const std::array<float, 4> stepSizes{0.001f, 0.002f, 0.005f, 0.01f};
+
+    std::array<GLuint, 2> queries{};
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+    auto timeDraws = [&](bool precomputed) {
+        shaderVolume->setUniform("usePrecomputedGradients", precomputed);
+        vaQuad->draw();
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+        for (int i = 0; i < numDraws; i++) {
+            vaQuad->draw();
         }
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+        GLuint64 start = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+        return static_cast<double>(end - start) * 1.0e-6 / numDraws;
+    };
+
+    // Normals are only needed by the isosurface.
+    glDisable(GL_DEPTH_TEST);
+    shaderVolume->setUniform("viewMode", static_cast<int>(ViewMode::Isosurface));
+    shaderVolume->setUniform("countSamples", false);
+    shaderVolume->setUniform("recordCost", false);
+    gradientBenchmark.clear();
+    std::cout << "Gradient benchmark (" << volumeRes.x << "x" << volumeRes.y << "x" << volumeRes.z
+              << ", isosurface):" << std::endl;
+    for (float size : stepSizes) {
+        shaderVolume->setUniform("stepSize", size);
+        GradientTiming timing{size, timeDraws(false), timeDraws(true)};
+        gradientBenchmark.push_back(timing);
+        std::cout << "  step " << timing.stepSize << ": on-the-fly " << timing.onTheFlyMs << " ms, precomputed "
+                  << timing.precomputedMs << " ms" << std::endl;
+    }
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+
+    shaderVolume->setUniform("viewMode", static_cast<int>(viewMode));
+    shaderVolume->setUniform("countSamples", countSamples);
+    shaderVolume->setUniform("recordCost", rayCostMap != nullptr);
+    shaderVolume->setUniform("stepSize", stepSize);
+    shaderVolume->setUniform("usePrecomputedGradients", usePrecomputedGradients);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+}
+
+/**
+ * @brief Benchmark the histogram engine with the current volume on a worker thread.
+ * Rendering pauses while the benchmark runs, so it does not compete for the CPU.
+ */
+void VolumeVis::runHistogramBenchmark() {
+    auto storage = volumeStorage;
+    const void* voxels = volumeVoxels;
+    const VoxelType type = volumeType;
+    const Histogram::ValueRange range = volumeRange;
+    const std::size_t numVoxels = static_cast<std::size_t>(volumeRes.x) * volumeRes.y * volumeRes.z;
+    loadResourceAsync<std::vector<Histogram::BenchmarkResult>>(
+        [storage, voxels, type, range, numVoxels]() {
+            return dispatchVoxelType(type, [&](auto traits) {
+                using T = typename decltype(traits)::Scalar;
+                return Histogram::benchmark(static_cast<const T*>(voxels), numVoxels, range);
+            });
+        },
+        [this, numVoxels](std::vector<Histogram::BenchmarkResult>& results) {
+            histoBenchmark = std::move(results);
+            std::cout << "Histogram benchmark (" << numVoxels << " voxels):" << std::endl;
+            for (const auto& result : histoBenchmark) {
+                std::cout << "  " << result.numThreads << " threads: " << result.ms << " ms, "
+                          << result.voxelsPerSecond / 1.0e6 << " MVoxel/s" << std::endl;
+            }
+        });
+}
+
+/**
+ * @brief Mapping of texture values to the normalized value range [0, 1] of the volume.
+ * value = texel * textureMax, normalized = (value - min) / (max - min)
+ * @return (scale, offset) with normalized = texel * scale + offset
+ */
+glm::vec2 VolumeVis::valueMapping() const {
+    const float textureMax = dispatchVoxelType(volumeType, [](auto traits) { return traits.textureMax; });
+    const float rangeExtent = volumeRange.max > volumeRange.min ? volumeRange.max - volumeRange.min : 1.0f;
+    return glm::vec2(textureMax / rangeExtent, -volumeRange.min / rangeExtent);
+}
+
+/**
+ * @brief Collect the uniforms of the volume shader for the CPU raycaster.
+ * @param viewport  The viewport of the volume
+ * @param projMx    The projection matrix
+ */
+CpuRaycaster::Parameters VolumeVis::raycastParameters(const glm::ivec4& viewport, const glm::mat4& projMx) const {
+    const glm::vec2 mapping = valueMapping();
+    CpuRaycaster::Parameters params{};
+    params.width = viewport.z;
+    params.height = viewport.w;
+    params.invViewMx = inverse(camera->viewMx());
+    params.invViewProjMx = inverse(camera->viewMx()) * inverse(projMx);
+    params.volumeDim = volumeDim;
+    params.viewMode = static_cast<int>(viewMode);
+    params.showBox = showBox;
+    params.useRandom = useRandom;
+    params.maxSteps = maxSteps;
+    params.stepSize = stepSize;
+    params.scale = scale;
+    params.isoValue = isoValue;
+    params.ambient = ambientColor;
+    params.diffuse = diffuseColor;
+    params.specular = specularColor;
+    params.kAmb = k_ambient;
+    params.kDiff = k_diffuse;
+    params.kSpec = k_specular;
+    params.kExp = k_exp;
+    params.valueScale = mapping.x;
+    params.valueOffset = mapping.y;
+    params.backgroundColor = backgroundColor;
+    params.preIntegration = usePreIntegration;
+    params.preIntegrationStep = preIntegrationStep;
+    return params;
+}
+
+/**
+ * @brief Render the current view with the CPU raycaster and compare it to the GPU image.
+ * The GPU image is read back from the framebuffer, the CPU image is rendered on a worker thread and saved as PNG
+ * together with its parameters for tools/cpuraycast.
+ * @param viewport  The viewport of the volume
+ * @param projMx    The projection matrix
+ */
+void VolumeVis::runCpuReference(const glm::ivec4& viewport, const glm::mat4& projMx) {
+    const int width = viewport.z;
+    const int height = viewport.w;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    std::vector<glm::vec3> gpuImage(static_cast<std::size_t>(width) * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(viewport.x, viewport.y, width, height, GL_RGB, GL_FLOAT, gpuImage.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    struct CpuReference {
+        double ms;
+        float maxError;
+        double meanError;
+        std::size_t numDifferentPixels;
+    };
+
+    const CpuRaycaster::Volume volume{volumeType, volumeVoxels, volumeRes};
+    const auto params = raycastParameters(viewport, projMx);
+    // Same size as the transfer function texture.
+    const std::vector<float> transferFunction(tfData.begin(),
+        tfData.begin() + static_cast<std::ptrdiff_t>(std::min(tfData.size(), 4 * histoNumBins)));
+    const std::string file = cpuReferenceFile;
+    loadResourceAsync<CpuReference>(
+        [storage = volumeStorage, volume, transferFunction, params, gpuImage = std::move(gpuImage), file,
+            fovY = fovY]() {
+            const auto start = std::chrono::high_resolution_clock::now();
+            const auto image = CpuRaycaster::render(volume, transferFunction, params);
+            CpuReference result{};
+            result.ms =
+                std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            // Differences per channel, GPU filtering uses fewer bits for the weights.
+            double errorSum = 0.0;
+            for (std::size_t i = 0; i < image.size(); i++) {
+                const glm::vec3 error = glm::abs(image[i] - gpuImage[i]);
+                const float maxError = std::max(std::max(error.x, error.y), error.z);
+                result.maxError = std::max(result.maxError, maxError);
+                result.numDifferentPixels += (maxError > 2.0f / 255.0f) ? 1 : 0;
+                errorSum += error.x + error.y + error.z;
+            }
+            result.meanError = errorSum / (3.0 * static_cast<double>(image.size()));
+
+            CpuRaycaster::writeImage(file, image, params.width, params.height);
+            // tools/cpuraycast renders the same image from the parameters without a GPU.
+            CpuRaycaster::writeParameters(std::filesystem::path(file).replace_extension(".params"), params, fovY);
+            return result;
+        },
+        [this, file, width, height](CpuReference& result) {
+            std::ostringstream summary;
+            summary << width << "x" << height << " in " << result.ms << " ms, saved to " << file << "\n"
+                    << "Difference to GPU: max " << result.maxError << ", mean " << result.meanError << ", "
+                    << result.numDifferentPixels << " pixels > 2/255";
+            cpuReferenceSummary = summary.str();
+            std::cout << "CPU reference: " << cpuReferenceSummary << std::endl;
+        });
+}
+
+/**
+ * @brief Set the value counts of the current volume and initialize the histogram. Derives the render parameters if
+ * enabled, once per loaded volume and only if they were not edited since the volume was selected.
+ * @param counts  The value counts of the current volume
+ */
+void VolumeVis::initStatistics(const Histogram::ValueCounts& counts) {
+    volumeStatistics.counts = counts;
+    volumeStatisticsComplete = true;
+    initHistogram(Histogram::toBins(counts, histoNumBins));
+    if (autoParameters && autoParametersPending) {
+        applyAutoParameters();
+    }
+    autoParametersPending = false;
+}
+
+/**
+ * @brief Set maxSteps, scale and isoValue from the statistics of the current volume and the step size.
+ */
+void VolumeVis::applyAutoParameters() {
+    const auto params = volumeStatistics.parameters(volumeRes, volumeDim, stepSize);
+    maxSteps = std::clamp(params.maxSteps, 1, 10000);
+    scale = params.scale;
+    isoValue = params.isoValue;
+}
+
+/**
+ * @brief Upload the min/max brick grid as 3D texture.
+ * @param grid  The brick grid of the current volume
+ */
+void VolumeVis::initBrickGrid(const BrickGrid& grid) {
+    if (brickTex == 0) {
+        glGenTextures(1, &brickTex);
+    }
+    glBindTexture(GL_TEXTURE_3D, brickTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (grid.ranges().empty()) {
+        // Never skip anything.
+        const glm::vec2 fullRange(0.0f, 1.0f);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RG32F, 1, 1, 1, 0, GL_RG, GL_FLOAT, &fullRange);
+    } else {
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RG32F, static_cast<GLsizei>(grid.res().x), static_cast<GLsizei>(grid.res().y),
+            static_cast<GLsizei>(grid.res().z), 0, GL_RG, GL_FLOAT, grid.ranges().data());
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+/**
+ * @brief Init the histogram vertex array.
+ * @param histogramValueArray   The number of values per bin
+ */
+void VolumeVis::initHistogram(const std::vector<float>& histogramValueArray) {
+    const std::size_t bins = histogramValueArray.size();
+    if (bins == 0) {
+        return;
     }
 
     // Create vertex array and indices
     std::vector<float> histogramVertices;
     std::vector<GLuint> histogramIndices;
+    histoMaxBinValue = 0;
     for (int i = 0; i < bins; i++) {
         histogramVertices.push_back(i / (float)(bins-1));
         histogramVertices.push_back(histogramValueArray[i]);
@@ -555,40 +1444,193 @@ void VolumeVis::genHistogram(std::size_t bins, const std::vector<std::uint8_t>&
     };
 
     vaHisto = std::make_unique<glowl::Mesh>(histoData, histogramIndices, GL_UNSIGNED_INT, GL_POINTS, GL_STATIC_DRAW);
-
-    delete[] histogramValueArray;
 }
 
 /**
  * @brief Initialize the transfer function.
+ * The vertex array and the 1D texture are created once and keep their size, edits only upload the changed entries in
+ * uploadTransferFunc().
  */
 void VolumeVis::initTransferFunc() {
     // --------------------------------------------------------------------------------
     //  TODO: Initialize the transfer function vertex array and load the transfer
     //        function data into a 1D texture.
     // --------------------------------------------------------------------------------
+    std::vector<float> tfColors(4 * histoNumBins, 0.0f);
+    std::copy_n(tfData.begin(), std::min(tfData.size(), tfColors.size()), tfColors.begin());
+
+    if (vaTransferFunc == nullptr) {
+        std::vector<float> tfLocations;
+        std::vector<GLuint> tfIndices;
+        for (int i = 0; i < histoNumBins; i++) {
+            tfLocations.push_back(i / (float)(histoNumBins-1));
+            tfIndices.push_back(i);
+        }
 
-    std::vector<float> tfLocations;
-    std::vector<GLuint> tfIndices;
-    for (int i = 0; i < histoNumBins; i++) {
-        tfLocations.push_back(i / (float)(histoNumBins-1));
-        tfIndices.push_back(i);
+        glowl::Mesh::VertexDataList<float> histoData{
+            {tfLocations, {4, {{1, GL_FLOAT, GL_FALSE, 0}}}},
+            {tfColors, {16, {{4, GL_FLOAT, GL_FALSE, 0}}}},
+        };
+
+        vaTransferFunc =
+            std::make_unique<glowl::Mesh>(histoData, tfIndices, GL_UNSIGNED_INT, GL_LINE_STRIP, GL_DYNAMIC_DRAW);
+    } else {
+        vaTransferFunc->bufferVertexSubData(1, tfColors, 0);
     }
 
-    glowl::Mesh::VertexDataList<float> histoData{
-        {tfLocations, {4, {{1, GL_FLOAT, GL_FALSE, 0}}}},
-        {tfData, {16, {{4, GL_FLOAT, GL_FALSE, 0}}}},
-    };
+    if (tfTex == 0) {
+        glGenTextures(1, &tfTex);
+        glBindTexture(GL_TEXTURE_1D, tfTex);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, histoNumBins, 0, GL_RGBA, GL_FLOAT, tfColors.data());
+    } else {
+        glBindTexture(GL_TEXTURE_1D, tfTex);
+        glTexSubImage1D(GL_TEXTURE_1D, 0, 0, histoNumBins, GL_RGBA, GL_FLOAT, tfColors.data());
+    }
+    glBindTexture(GL_TEXTURE_1D, 0);
+    tfDirtyFirst = 0;
+    tfDirtyLast = 0;
 
-    vaTransferFunc = std::make_unique<glowl::Mesh>(histoData, tfIndices, GL_UNSIGNED_INT, GL_LINE_STRIP, GL_STATIC_DRAW);
+    initTfAlphaMax(0, histoNumBins);
+    preIntegratedDirtyFirst = 0;
+    preIntegratedDirtyLast = histoNumBins;
+}
 
-    glGenTextures(1, &tfTex);
-    glBindTexture(GL_TEXTURE_1D, tfTex);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, histoNumBins, 0, GL_RGBA, GL_FLOAT, tfData.data());
-    glBindTexture(GL_TEXTURE_1D, 0);
+/**
+ * @brief Upload the transfer function entries changed since the last frame.
+ * Only the dirty range of the vertex buffer and the 1D texture is updated, so dragging in the editor does not
+ * reallocate anything. The tables derived from the transfer function are updated where they depend on the dirty
+ * range once per frame, the pre-integrated table only while pre-integration is on.
+ */
+void VolumeVis::uploadTransferFunc() {
+    const std::size_t first = tfDirtyFirst;
+    const std::size_t last = std::min({tfDirtyLast, histoNumBins, tfData.size() / 4});
+    tfDirtyFirst = 0;
+    tfDirtyLast = 0;
+    if (first < last && vaTransferFunc != nullptr) {
+        const std::vector<float> tfColors(tfData.begin() + static_cast<std::ptrdiff_t>(4 * first),
+            tfData.begin() + static_cast<std::ptrdiff_t>(4 * last));
+        vaTransferFunc->bufferVertexSubData(1, tfColors, static_cast<GLsizeiptr>(4 * first * sizeof(float)));
+        glBindTexture(GL_TEXTURE_1D, tfTex);
+        glTexSubImage1D(GL_TEXTURE_1D, 0, static_cast<GLint>(first), static_cast<GLsizei>(last - first), GL_RGBA,
+            GL_FLOAT, tfColors.data());
+        glBindTexture(GL_TEXTURE_1D, 0);
+
+        initTfAlphaMax(first, last);
+        if (preIntegratedDirtyFirst == preIntegratedDirtyLast) {
+            preIntegratedDirtyFirst = first;
+            preIntegratedDirtyLast = last;
+        } else {
+            preIntegratedDirtyFirst = std::min(preIntegratedDirtyFirst, first);
+            preIntegratedDirtyLast = std::max(preIntegratedDirtyLast, last);
+        }
+    }
+
+    // Edits while pre-integration is off only extend the dirty range, the table is updated once it is turned on.
+    if (usePreIntegration && preIntegratedDirtyFirst < preIntegratedDirtyLast) {
+        initPreIntegratedTable();
+    }
+}
+
+/**
+ * @brief Tabulate the maximum alpha of all transfer function ranges [first, last] for empty-space skipping.
+ * The table is stored as 2D texture with x = last and y = first. Only the ranges which contain one of the changed
+ * entries [changedFirst, changedLast) are recomputed and uploaded: the columns from changedFirst of the rows before
+ * changedLast.
+ * @param changedFirst  First changed transfer function entry
+ * @param changedLast   End of the changed entries
+ */
+void VolumeVis::initTfAlphaMax(std::size_t changedFirst, std::size_t changedLast) {
+    // Same size as the transfer function texture.
+    const std::size_t n = std::min(histoNumBins, tfData.size() / 4);
+    if (tfAlphaMax.size() != n * n) {
+        tfAlphaMax.assign(n * n, 0.0f);
+        changedFirst = 0;
+        changedLast = n;
+    }
+    changedLast = std::min(changedLast, n);
+    if (changedFirst >= changedLast) {
+        return;
+    }
+    for (std::size_t first = 0; first < changedLast; first++) {
+        // The maximum of the unchanged entries [first, changedFirst) is still in the table.
+        const std::size_t begin = std::max(first, changedFirst);
+        float alpha = begin > first ? tfAlphaMax[first * n + begin - 1] : 0.0f;
+        for (std::size_t last = begin; last < n; last++) {
+            alpha = std::max(alpha, tfData[4 * last + 3]);
+            tfAlphaMax[first * n + last] = alpha;
+        }
+    }
+
+    if (tfAlphaMaxTex == 0) {
+        glGenTextures(1, &tfAlphaMaxTex);
+        glBindTexture(GL_TEXTURE_2D, tfAlphaMaxTex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, static_cast<GLsizei>(n), static_cast<GLsizei>(n), 0, GL_RED,
+            GL_FLOAT, tfAlphaMax.data());
+    } else {
+        glBindTexture(GL_TEXTURE_2D, tfAlphaMaxTex);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(n));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(changedFirst), 0, static_cast<GLsizei>(n - changedFirst),
+            static_cast<GLsizei>(changedLast), GL_RED, GL_FLOAT, &tfAlphaMax[changedFirst]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/**
+ * @brief Update the pre-integrated transfer function table for the dirty entries and upload it as 2D texture.
+ * The table is sampled with linear filtering at (back value, front value) like the 1D transfer function texture.
+ * The texture is created once, later only the entries changed by PreIntegratedTable::update() are uploaded.
+ */
+void VolumeVis::initPreIntegratedTable() {
+    // Same size as the transfer function texture.
+    const std::size_t n = std::min(histoNumBins, tfData.size() / 4);
+    const std::size_t first = preIntegratedDirtyFirst;
+    const std::size_t last = std::min(preIntegratedDirtyLast, n);
+    preIntegratedDirtyFirst = 0;
+    preIntegratedDirtyLast = 0;
+    const std::vector<float> transferFunction(tfData.begin(), tfData.begin() + static_cast<std::ptrdiff_t>(4 * n));
+
+    if (preIntegratedTex == 0 || preIntegrated.size() != 4 * n * n) {
+        preIntegrated = PreIntegratedTable::build(transferFunction);
+        if (preIntegratedTex == 0) {
+            glGenTextures(1, &preIntegratedTex);
+        }
+        glBindTexture(GL_TEXTURE_2D, preIntegratedTex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(n), static_cast<GLsizei>(n), 0, GL_RGBA,
+            GL_FLOAT, preIntegrated.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return;
+    }
+    if (first >= last) {
+        return;
+    }
+
+    PreIntegratedTable::update(preIntegrated, transferFunction, first, last);
+    auto uploadRect = [this, n](std::size_t x, std::size_t y, std::size_t width, std::size_t height) {
+        if (width > 0 && height > 0) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(x), static_cast<GLint>(y),
+                static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RGBA, GL_FLOAT,
+                &preIntegrated[4 * (y * n + x)]);
+        }
+    };
+    glBindTexture(GL_TEXTURE_2D, preIntegratedTex);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(n));
+    uploadRect(first, 0, n - first, first);
+    uploadRect(0, first, n, last - first);
+    uploadRect(0, last, last, n - last);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 /**
@@ -604,11 +1646,13 @@ void VolumeVis::updateTransferFunc(int channel, float value) {
     {
         tfData[4*i+channel] = value;
     }
-    initTransferFunc();
+    tfDirtyFirst = 0;
+    tfDirtyLast = tfNumPoints;
 }
 
 /**
  * @brief Update the transfer function, set the value at index "idx" of "channel" to "value".
+ * The change is uploaded with the next frame.
  * @param idx      The index at which to modify the channel
  * @param channel  The channel to modify
  * @param value    The value to set the channel to at the given index
@@ -618,16 +1662,20 @@ void VolumeVis::updateTransferFunc(int idx, int channel, float value) {
     //  TODO: Update the transfer function. Don't forget to update the texture and VA.
     // --------------------------------------------------------------------------------
     tfData[4*idx+channel] = value;
-    initTransferFunc();
-}
-
-std::tuple<std::string, std::string> getNext(std::string s, std::string delimiter) {
-    size_t i = s.find(delimiter);
-    return std::make_tuple(s.substr(i+1),s.substr(0, i));
+    const auto entry = static_cast<std::size_t>(idx);
+    if (tfDirtyFirst == tfDirtyLast) {
+        tfDirtyFirst = entry;
+        tfDirtyLast = entry + 1;
+    } else {
+        tfDirtyFirst = std::min(tfDirtyFirst, entry);
+        tfDirtyLast = std::max(tfDirtyLast, entry + 1);
+    }
 }
 
 /**
  * @brief Load a transfer function from the given file.
+ * Text (.tf) and binary (.tfb) files with any number of entries are resampled to the texture resolution. The new
+ * values are uploaded with the next frame.
  * @param filename The file to load the transfer function from
  */
 void VolumeVis::loadTransferFunc(const std::string& filename) {
@@ -636,44 +1684,20 @@ void VolumeVis::loadTransferFunc(const std::string& filename) {
     // --------------------------------------------------------------------------------
     //  TODO: Load the transfer function from file "path".
     // --------------------------------------------------------------------------------
-    std::string tf = getStringResource(path);
-    std::string number;
-    std::tie(tf, number) = getNext(tf, "\n");
-    tfNumPoints = std::stoi(number);
-    assert(tfNumPoints == histoNumBins && "tfNumPoints is not equal to histoNumBins");
-
-    std::string rgba;
-    for (int i = 0; i < tfNumPoints; i++)
-    {
-        std::tie(tf, rgba) = getNext(tf, "\n");
-        // std::cout << rgba << std::endl;
-        
-        std::string data;
-
-        //r
-        std::tie(rgba, data) = getNext(rgba, " ");
-        tfData.push_back(std::stof(data));
-        //g
-        std::tie(rgba, data) = getNext(rgba, " ");
-        tfData.push_back(std::stof(data));
-        //b
-        std::tie(rgba, data) = getNext(rgba, " ");
-        tfData.push_back(std::stof(data));
-        //a
-        tfData.push_back(std::stof(rgba));
+    try {
+        tfData = TransferFunction::resample(TransferFunction::read(path), histoNumBins);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return;
     }
-    
-    // for (int i = 0; i < tfNumPoints; i++)
-    // {
-    //     int j = 4*i;
-    //     std::cout << tfData[j] << " " << tfData[j+1] << " " << tfData[j+2] << " " << tfData[j+3] << std::endl;
-    // }
-
+    tfNumPoints = histoNumBins;
+    tfDirtyFirst = 0;
+    tfDirtyLast = tfNumPoints;
 }
 
 /**
- * @brief Save the current transfer function to a file.
- * @param filename The filename to save the transfer function to.
+ * @brief Save the transfer function to the given file, as binary file if the extension is .tfb.
+ * @param filename The file to save the transfer function to
  */
 void VolumeVis::saveTransferFunc(const std::string& filename) {
     auto path = getResourceDirPath("transfer") / filename;
@@ -681,12 +1705,9 @@ void VolumeVis::saveTransferFunc(const std::string& filename) {
     // --------------------------------------------------------------------------------
     //  TODO: Save transfer function to file "path".
     // --------------------------------------------------------------------------------
-    std::ofstream f(path);
-    f << tfNumPoints << std::endl;
-    for (size_t i = 0; i < tfNumPoints; i++)
-    {
-        int j = 4*i;
-        f << std::to_string(tfData[j]) << " " << std::to_string(tfData[j+1]) << " " << std::to_string(tfData[j+2]) << " " << std::to_string(tfData[j+3]) << std::endl;
+    try {
+        TransferFunction::write(path, tfData);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
     }
-    
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <vector>
@@ -11,6 +14,15 @@
 #include "core/camera/OrbitCamera.h"
 #include "core/PluginRegister.h"
 #include "core/RenderPlugin.h"
+#include "BrickGrid.h"
+#include "CpuRaycaster.h"
+#include "Histogram.h"
+#include "PagedVolume.h"
+#include "RayCostMap.h"
+#include "TimeSeries.h"
+#include "VolumeStatistics.h"
+#include "VolumeStream.h"
+#include "VoxelType.h"
 
 namespace OGL4Core2::Plugins::PCVC::VolumeVis {
 
@@ -33,6 +45,12 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
     private:
         enum class ViewMode { LineOfSight = 0, Mip = 1, Isosurface = 2, Volume = 3, Noise = 4 };
 
+        struct GradientTiming {
+            float stepSize;
+            double onTheFlyMs;    //!< GPU time of the volume pass with central differences in the shader
+            double precomputedMs; //!< GPU time of the volume pass with the gradient texture
+        };
+
         void renderGUI();
 
         void initShaders();
@@ -40,9 +58,23 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         void initVAs();
 
         void loadVolumeFile(int idx);
-        void genHistogram(std::size_t bins, const std::vector<std::uint8_t>& values);
+        GLuint createVolumeTexture() const;
+        void updateGradients();
+        void runGradientBenchmark();
+        void advanceTimeSeries();
+        void runHistogramBenchmark();
+        glm::vec2 valueMapping() const;
+        CpuRaycaster::Parameters raycastParameters(const glm::ivec4& viewport, const glm::mat4& projMx) const;
+        void runCpuReference(const glm::ivec4& viewport, const glm::mat4& projMx);
+        void initHistogram(const std::vector<float>& histogramValueArray);
+        void initStatistics(const Histogram::ValueCounts& counts);
+        void applyAutoParameters();
+        void initBrickGrid(const BrickGrid& grid);
 
         void initTransferFunc();
+        void uploadTransferFunc();
+        void initTfAlphaMax(std::size_t changedFirst, std::size_t changedLast);
+        void initPreIntegratedTable();
         void updateTransferFunc(int channel, float value);
         void updateTransferFunc(int idx, int channel, float value);
         void loadTransferFunc(const std::string& filename);
@@ -58,6 +90,34 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
 
         glm::uvec3 volumeRes;
         glm::vec3 volumeDim;
+        VoxelType volumeType;                       //!< scalar type of the volume
+        Histogram::ValueRange volumeRange;          //!< value range mapped to [0, 1] for transfer function lookups
+        VolumeStatistics volumeStatistics;          //!< statistics of the current volume
+        bool volumeStatisticsComplete;              //!< the value counts of volumeStatistics are set
+        std::shared_ptr<const void> volumeStorage;  //!< keeps the memory mapping or read buffer of the volume alive
+        const void* volumeVoxels;                   //!< CPU copy of the volume, points into volumeStorage
+        std::uint64_t volumeGeneration;             //!< incremented whenever volumeVoxels is replaced
+        std::shared_ptr<VolumeStream> volumeStream; //!< upload of the current volume
+        std::unique_ptr<PagedVolume> pagedVolume;   //!< out-of-core rendering of the current volume, if paged
+
+        std::unique_ptr<TimeSeries> timeSeries; //!< prefetching of the following steps, if the volume is a time series
+        GLuint backVolumeTex;                   //!< texture the next time step is uploaded to before the swap
+        std::size_t currentTimeStep;            //!< time step in volumeTex
+        bool playing;                           //!< toggle time series playback
+        bool showNextStep;                      //!< show the next prefetched step, also while paused
+        float playbackRate;                     //!< time steps per second
+        int prefetchSteps;                      //!< capacity of the prefetch ring, applies to the next loaded volume
+        std::chrono::steady_clock::time_point lastStepTime;
+        bool playbackStalled;                              //!< the next step was due but not prefetched yet
+        std::chrono::steady_clock::time_point stallStart;  //!< begin of the current stall
+        std::size_t playbackStalls;                        //!< number of stalls
+        double playbackStallMs;                            //!< total time spent waiting for prefetching
+
+        bool forcePaging;          //!< page bricked volumes even if they fit into the atlas budget
+        int pagingHostBudget;      //!< budget of the CPU brick cache in MiB
+        int pagingDeviceBudget;    //!< budget of the brick atlas in MiB, larger bricked volumes are paged
+        int pagingUploadsPerFrame; //!< maximum number of brick uploads per frame
+        float lodBias;             //!< added to the level of detail of paged volumes
 
         std::shared_ptr<Core::OrbitCamera> camera; //!< camera
         float fovY;                                //!< camera's vertical field of view
@@ -67,9 +127,30 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         bool showBox;         //!< toggle box drawing
         ViewMode viewMode;
 
-        int maxSteps;   //!< Maximum number of integration steps
-        float stepSize; //!< Step size
-        float scale;    //!< Global scaling factor
+        bool useSkipping;        //!< toggle empty-space skipping with the brick grid
+        bool countSamples;       //!< toggle counting of taken and skipped samples, stalls on the read back
+        uint64_t takenSamples;   //!< number of samples taken in the last frame
+        uint64_t skippedSamples; //!< number of samples skipped in the last frame
+
+        bool recordRayCost;                     //!< toggle recording of the steps and termination of each ray
+        std::unique_ptr<RayCostMap> rayCostMap; //!< ray cost image of the last frame, while recording
+
+        bool usePrecomputedGradients;                  //!< shade with the gradient texture, not central differences
+        std::uint64_t gradientGeneration;              //!< volumeGeneration the gradient texture was computed from
+        bool gradientPending;                          //!< gradient computation is running
+        double gradientMs;                             //!< CPU time of the last gradient computation
+        bool gradientBenchmarkRequested;               //!< compare both gradients in the next frame
+        std::vector<GradientTiming> gradientBenchmark; //!< results of the last gradient benchmark
+
+        bool cpuReferenceRequested;      //!< render a CPU reference of the next frame
+        std::string cpuReferenceFile;    //!< PNG file for the CPU reference image
+        std::string cpuReferenceSummary; //!< timing and difference to the GPU image of the last CPU reference
+
+        int maxSteps;               //!< Maximum number of integration steps
+        float stepSize;             //!< Step size
+        float scale;                //!< Global scaling factor
+        bool autoParameters;        //!< derive maxSteps, scale and isoValue from the statistics of each loaded volume
+        bool autoParametersPending; //!< the current volume is loading and none of these parameters were edited since
 
         float isoValue;
         glm::vec3 ambientColor;
@@ -82,6 +163,18 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
 
         std::size_t tfNumPoints;   //!< number of point for transfer functions
         std::vector<float> tfData; //!< transfer function values (r,g,b,a)
+        std::size_t tfDirtyFirst;  //!< first entry of tfData changed since the last upload
+        std::size_t tfDirtyLast;   //!< end of the changed entries, equal to tfDirtyFirst if nothing changed
+        int tfPaintLastX;          //!< entry painted last in the current Ctrl-drag, -1 if not painting
+        float tfPaintLastValue;    //!< value painted at tfPaintLastX
+
+        bool usePreIntegration;   //!< toggle pre-integrated classification in volume mode
+        float preIntegrationStep; //!< step size at which pre-integrated segments are as opaque as single samples
+
+        std::vector<float> tfAlphaMax;       //!< maximum alpha of all transfer function ranges, see initTfAlphaMax()
+        std::vector<float> preIntegrated;    //!< pre-integrated table, kept to update the dirty entries only
+        std::size_t preIntegratedDirtyFirst; //!< first entry of tfData changed since the last table update
+        std::size_t preIntegratedDirtyLast;  //!< end of the changed entries, equal to preIntegratedDirtyFirst if none
 
         int editorHeight;       //!< Height of the colormap editor/histogram panel
         int colormapHeight;     //!< Height of the colormap preview panel
@@ -93,6 +186,8 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         std::size_t histoNumBins;  //!< number of bins for histogram
         uint32_t histoMaxBinValue; //!< maximum bin value
 
+        std::vector<Histogram::BenchmarkResult> histoBenchmark; //!< results of the last histogram benchmark
+
         std::unique_ptr<glowl::GLSLProgram> shaderVolume;     //!< shader program for volume rendering
         std::unique_ptr<glowl::GLSLProgram> shaderBackground; //!< shader program for box rendering
         std::unique_ptr<glowl::GLSLProgram> shaderHisto;      //!< shader program for histogram rendering
@@ -103,7 +198,12 @@ namespace OGL4Core2::Plugins::PCVC::VolumeVis {
         std::unique_ptr<glowl::Mesh> vaHisto;        //!< vertex array for histogram data
         std::unique_ptr<glowl::Mesh> vaTransferFunc; //!< vertex array for transfer functions
 
-        GLuint volumeTex; //!< texture handle for volume data
-        GLuint tfTex;     //!< transfer function texture handle
+        GLuint volumeTex;         //!< texture handle for volume data
+        GLuint tfTex;             //!< transfer function texture handle
+        GLuint brickTex;          //!< texture handle for the min/max brick grid
+        GLuint tfAlphaMaxTex;     //!< texture handle for the maximum alpha of transfer function ranges
+        GLuint gradientTex;       //!< texture handle for the precomputed gradients
+        GLuint preIntegratedTex;  //!< texture handle for the pre-integrated transfer function table
+        GLuint sampleCountBuffer; //!< shader storage buffer for the sample counts
     };
 } // namespace OGL4Core2::Plugins::PCVC::VolumeVis
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include <glad/gl.h>
+
+namespace OGL4Core2::Plugins::PCVC::VolumeVis {
+    /**
+     * Scalar types of volume data.
+     */
+    enum class VoxelType { UInt8, UInt16, Float32 };
+
+    /**
+     * C++ type and OpenGL texture format of a voxel type. `textureMax` is the value which a texture lookup returns as
+     * 1.0, i.e. texel * textureMax is the voxel value.
+     */
+    template<typename T>
+    struct VoxelTraits;
+
+    template<>
+    struct VoxelTraits<std::uint8_t> {
+        using Scalar = std::uint8_t;
+        static constexpr VoxelType type = VoxelType::UInt8;
+        static constexpr GLint internalFormat = GL_R8;
+        static constexpr GLenum glType = GL_UNSIGNED_BYTE;
+        static constexpr float textureMax = 255.0f;
+    };
+
+    template<>
+    struct VoxelTraits<std::uint16_t> {
+        using Scalar = std::uint16_t;
+        static constexpr VoxelType type = VoxelType::UInt16;
+        static constexpr GLint internalFormat = GL_R16;
+        static constexpr GLenum glType = GL_UNSIGNED_SHORT;
+        static constexpr float textureMax = 65535.0f;
+    };
+
+    template<>
+    struct VoxelTraits<float> {
+        using Scalar = float;
+        static constexpr VoxelType type = VoxelType::Float32;
+        static constexpr GLint internalFormat = GL_R32F;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr float textureMax = 1.0f;
+    };
+
+    /**
+     * Call `f` with the VoxelTraits of `type`. This instantiates a code path per voxel type:
+     *
+     *     dispatchVoxelType(type, [&](auto traits) {
+     *         using T = typename decltype(traits)::Scalar;
+     *         ...
+     *     });
+     */
+    template<typename F>
+    decltype(auto) dispatchVoxelType(VoxelType type, F&& f) {
+        switch (type) {
+            case VoxelType::UInt8:
+                return f(VoxelTraits<std::uint8_t>{});
+            case VoxelType::UInt16:
+                return f(VoxelTraits<std::uint16_t>{});
+            case VoxelType::Float32:
+                return f(VoxelTraits<float>{});
+        }
+        throw std::runtime_error("Unknown voxel type!");
+    }
+
+    inline std::size_t voxelSize(VoxelType type) {
+        return dispatchVoxelType(type, [](auto traits) { return sizeof(typename decltype(traits)::Scalar); });
+    }
+} // namespace OGL4Core2::Plugins::PCVC::VolumeVis
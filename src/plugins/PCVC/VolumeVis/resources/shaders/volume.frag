@@ -7,6 +7,8 @@
 
 uniform sampler3D volumeTex; //!< 3D texture handle
 uniform sampler1D transferTex;
+uniform sampler3D brickTex;      //!< normalized (min, max) value per brick
+uniform sampler2D tfAlphaMaxTex; //!< maximum alpha of the transfer function entries [y, x]
 
 uniform mat4 invViewMx;     //!< inverse view matrix
 uniform mat4 invViewProjMx; //!< inverse view-projection matrix
@@ -14,6 +16,9 @@ uniform mat4 invViewProjMx; //!< inverse view-projection matrix
 uniform vec3 volumeRes; //!< volume resolution
 uniform vec3 volumeDim; //!< volume dimensions
 
+uniform float valueScale;  //!< maps texel values of the volume's value range to [0, 1]
+uniform float valueOffset; //!< maps texel values of the volume's value range to [0, 1]
+
 uniform int viewMode; //<! rendering method: 0: line-of-sight, 1: mip, 2: isosurface, 3: volume
 uniform bool showBox;
 uniform bool useRandom;
@@ -33,9 +38,70 @@ uniform float k_diff; //!< diffuse factor
 uniform float k_spec; //!< specular factor
 uniform float k_exp;  //!< specular exponent
 
+uniform bool useSkipping;  //!< skip the inside of bricks which cannot contribute
+uniform int brickSize;     //!< brick size in voxels
+uniform bool countSamples; //!< count taken and skipped samples
+
+uniform bool usePaging;      //!< sample the brick atlas of an out-of-core volume instead of volumeTex
+uniform sampler3D atlasTex;  //!< resident bricks of all levels, brickSize + 1 voxels per slot and axis
+uniform int pageFrame;       //!< number of the frame, marks the brick requests
+uniform int maxPageRequests; //!< capacity of the brick request buffer
+uniform float lodScale;      //!< footprint of a pixel at distance 1 in voxels of level 0
+uniform float lodBias;       //!< added to the level of detail
+
+uniform bool usePrecomputedGradients; //!< take the normals from gradientTex
+uniform sampler3D gradientTex;        //!< packed normal (rgb) and gradient magnitude (a) per voxel
+
+uniform bool usePreIntegration;     //!< classify segments between samples with preIntegratedTex
+uniform sampler2D preIntegratedTex; //!< averaged (value * rgb, alpha) of segments [back value, front value]
+uniform float preIntegrationStep;   //!< step size the transfer function is designed for
+
+uniform bool recordCost; //!< write the steps and the termination of each ray to costImage and costCounts
+
 uniform int width;
 uniform int height;
 
+layout(std430, binding = 0) buffer SampleCounts {
+    uint takenSamples;
+    uint skippedSamples;
+};
+
+struct PageLevel {
+    ivec4 res;  //!< resolution of the level
+    ivec4 grid; //!< brick grid of the level, w: index of its first brick
+};
+
+layout(std430, binding = 1) readonly buffer PageTable {
+    ivec4 pageAtlas; //!< xyz: slots per axis, w: brick size
+    ivec4 pageInfo;  //!< x: number of levels
+    PageLevel pageLevels[16];
+    uint pageTable[]; //!< per brick of all levels, 0: not resident, otherwise atlas slot + 1
+};
+
+layout(std430, binding = 2) buffer PageUsage {
+    uint pageUsage[]; //!< frame of the last request per brick
+};
+
+layout(std430, binding = 3) buffer PageRequests {
+    uint numPageRequests;
+    uint pageRequests[];
+};
+
+uint lastPageRequest = 0xFFFFFFFFu; //!< consecutive samples usually hit the same brick
+
+// Why a ray stopped marching.
+const uint rayLeftVolume = 0u;
+const uint rayReachedMaxSteps = 1u;
+const uint rayHitSurface = 2u;
+
+layout(std430, binding = 4) buffer CostCounts {
+    uint costRays;            //!< rays which entered the volume
+    uint costTerminations[3]; //!< rays per termination reason
+};
+
+//! Per pixel: 0 if no ray was marched, otherwise (termination + 1) << 24 | steps.
+layout(r32ui, binding = 0) uniform writeonly uimage2D costImage;
+
 in vec2 texCoords;
 
 layout(location = 0) out vec4 fragColor;
@@ -140,6 +206,163 @@ vec3 mapTexCoords(vec3 pos) {
     return pos / volumeDim + vec3(0.5);
 }
 
+/**
+ * Report a brick the raycaster wants, at most once per frame.
+ * @param page          The index of the brick over all levels
+ */
+void requestPage(uint page) {
+    if (page == lastPageRequest) {
+        return;
+    }
+    lastPageRequest = page;
+    uint frame = uint(pageFrame);
+    if (pageUsage[page] != frame && atomicExchange(pageUsage[page], frame) != frame) {
+        uint n = atomicAdd(numPageRequests, 1u);
+        if (n < uint(maxPageRequests)) {
+            pageRequests[n] = page;
+        }
+    }
+}
+
+/**
+ * Sample the brick atlas at world coordinates. The level of detail matches the footprint of a pixel at the sample
+ * position, coarser levels are used while its brick is not resident.
+ * @param pos           The world coordinates to sample at
+ */
+float samplePaged(vec3 pos) {
+    vec3 texCoords = mapTexCoords(pos);
+    float footprint = distance(pos, invViewMx[3].xyz) * lodScale;
+    int numLevels = pageInfo.x;
+    int level = clamp(int(floor(log2(max(footprint, 1e-6)) + lodBias)), 0, numLevels - 1);
+    for (int l = level; l < numLevels; l++) {
+        ivec3 res = pageLevels[l].res.xyz;
+        ivec3 grid = pageLevels[l].grid.xyz;
+        // Voxel coordinates with texel centers at integers, wrapped like GL_REPEAT. The brick of the lower voxel
+        // contains the upper one as well.
+        vec3 voxel = mod(texCoords * vec3(res) - 0.5, vec3(res));
+        ivec3 brick = min(ivec3(floor(voxel)), res - 1) / pageAtlas.w;
+        uint page = uint(pageLevels[l].grid.w + (brick.z * grid.y + brick.y) * grid.x + brick.x);
+        if (l == level) {
+            requestPage(page);
+        }
+        uint entry = pageTable[page];
+        if (entry != 0u) {
+            int slot = int(entry - 1u);
+            ivec3 slotCoord = ivec3(slot % pageAtlas.x, (slot / pageAtlas.x) % pageAtlas.y,
+                slot / (pageAtlas.x * pageAtlas.y));
+            vec3 local = voxel - vec3(brick * pageAtlas.w);
+            vec3 atlasPos = (vec3(slotCoord * (pageAtlas.w + 1)) + local + 0.5) / vec3(textureSize(atlasTex, 0));
+            return texture(atlasTex, atlasPos).x * valueScale + valueOffset;
+        }
+    }
+    return 0.0;
+}
+
+/**
+ * Sample the volume at world coordinates. The value range of the volume is mapped to [0, 1].
+ * @param pos           The world coordinates to sample at
+ */
+float sampleVolume(vec3 pos) {
+    if (usePaging) {
+        return samplePaged(pos);
+    }
+    return texture(volumeTex, mapTexCoords(pos)).x * valueScale + valueOffset;
+}
+
+/**
+ * Index of the brick which contains the given world position.
+ */
+ivec3 brickAt(vec3 pos) {
+    ivec3 brick = ivec3(floor(mapTexCoords(pos) * volumeRes / float(brickSize)));
+    return clamp(brick, ivec3(0), textureSize(brickTex, 0) - 1);
+}
+
+/**
+ * Normalized value range of the brick which contains the given world position.
+ */
+vec2 brickRange(vec3 pos) {
+    return texelFetch(brickTex, brickAt(pos), 0).rg;
+}
+
+/**
+ * Test if all samples inside a brick map to zero opacity. The transfer function texture is filtered linearly and
+ * repeats, so the entries next to the range are included.
+ * @param range         The normalized value range of the brick
+ */
+bool isTransparent(vec2 range) {
+    if (range.x < 0.0 || range.y > 1.0) {
+        return false;
+    }
+    int n = textureSize(transferTex, 0);
+    int first = int(floor(range.x * n - 0.5));
+    int last = int(floor(range.y * n - 0.5)) + 1;
+    float alpha = texelFetch(tfAlphaMaxTex, ivec2(clamp(last, 0, n - 1), clamp(first, 0, n - 1)), 0).r;
+    if (first < 0) {
+        alpha = max(alpha, texelFetch(tfAlphaMaxTex, ivec2(n - 1, n - 1), 0).r);
+    }
+    if (last > n - 1) {
+        alpha = max(alpha, texelFetch(tfAlphaMaxTex, ivec2(0, 0), 0).r);
+    }
+    return alpha <= 0.0;
+}
+
+/**
+ * Index of the last sample inside the brick which contains the given world position.
+ * @param r             The ray
+ * @param pos           The world position of the current sample
+ * @param tNear         The distance of the first intersection with the volume
+ * @param sampleOffset  Offset of the samples, sample i is at t = stepSize * (i + sampleOffset) + tNear
+ */
+int lastSampleInBrick(Ray r, vec3 pos, float tNear, float sampleOffset) {
+    vec3 brick = vec3(brickAt(pos));
+    vec3 brickMin = (brick * float(brickSize) / volumeRes - 0.5) * volumeDim;
+    vec3 brickMax = (min((brick + 1.0) * float(brickSize) / volumeRes, vec3(1.0)) - 0.5) * volumeDim;
+    // Avoid 0 / 0, an axis without movement never exits the brick.
+    vec3 dir = mix(r.d, vec3(1e-20), equal(r.d, vec3(0.0)));
+    vec3 tExit = (mix(brickMin, brickMax, greaterThan(dir, vec3(0.0))) - r.o) / dir;
+    float t = min(min(tExit.x, tExit.y), tExit.z);
+    // Samples slightly outside of the brick are still covered by the border of the brick range.
+    return int(ceil((t - tNear) / stepSize - sampleOffset)) - 1;
+}
+
+/**
+ * Advance the sample index to the last sample inside the current brick. The samples in between are skipped, the
+ * last one is taken again to continue the integration.
+ * @param i             The current sample index
+ * @param numSkipped    The number of skipped samples
+ */
+void skipBrick(Ray r, vec3 pos, float tNear, float sampleOffset, inout int i, inout int numSkipped) {
+    int last = min(lastSampleInBrick(r, pos, tNear, sampleOffset), maxSteps + 1);
+    if (last > i + 1) {
+        numSkipped += last - i - 1;
+        i = last - 1;
+    }
+}
+
+/**
+ * Add the sample counts of this fragment to the statistics.
+ */
+void addSampleCounts(int numTaken, int numSkipped) {
+    if (countSamples) {
+        atomicAdd(takenSamples, uint(numTaken));
+        atomicAdd(skippedSamples, uint(numSkipped));
+    }
+}
+
+/**
+ * Record the cost of the ray of this fragment.
+ * @param numTaken      The number of samples taken
+ * @param termination   Why the ray stopped
+ */
+void recordRayCost(int numTaken, uint termination) {
+    if (recordCost) {
+        uint cost = ((termination + 1u) << 24) | uint(min(numTaken, 0xFFFFFF));
+        imageStore(costImage, ivec2(gl_FragCoord.xy), uvec4(cost));
+        atomicAdd(costRays, 1u);
+        atomicAdd(costTerminations[termination], 1u);
+    }
+}
+
 /**
  * Calculate normals based on the volume gradient.
  */
@@ -147,8 +370,18 @@ vec3 calcNormal(vec3 pos) {
     // --------------------------------------------------------------------------------
     //  TODO: Calculate normals based on volume gradient.
     // --------------------------------------------------------------------------------
-    vec3 volumeCoord = mapTexCoords(pos);
+    if (usePrecomputedGradients) {
+        return normalize(texture(gradientTex, mapTexCoords(pos)).xyz * 2.0 - 1.0);
+    }
     vec3 gradient;
+    if (usePaging) {
+        vec3 h = volumeDim / volumeRes;
+        gradient.x = sampleVolume(pos + vec3(h.x, 0.0, 0.0)) - sampleVolume(pos - vec3(h.x, 0.0, 0.0));
+        gradient.y = sampleVolume(pos + vec3(0.0, h.y, 0.0)) - sampleVolume(pos - vec3(0.0, h.y, 0.0));
+        gradient.z = sampleVolume(pos + vec3(0.0, 0.0, h.z)) - sampleVolume(pos - vec3(0.0, 0.0, h.z));
+        return normalize(gradient);
+    }
+    vec3 volumeCoord = mapTexCoords(pos);
     gradient.x = textureOffset(volumeTex, volumeCoord, ivec3(1, 0, 0)).x - textureOffset(volumeTex, volumeCoord, ivec3(-1, 0, 0)).x;
     gradient.y = textureOffset(volumeTex, volumeCoord, ivec3(0, 1, 0)).x - textureOffset(volumeTex, volumeCoord, ivec3(0, -1, 0)).x;
     gradient.z = textureOffset(volumeTex, volumeCoord, ivec3(0, 0, 1)).x - textureOffset(volumeTex, volumeCoord, ivec3(0, 0, -1)).x;
@@ -232,14 +465,29 @@ void main() {
             //  TODO: Implement line of sight (LoS) rendering.
             // --------------------------------------------------------------------------------
             float intensity = 0.0f;
+            int numTaken = 0;
+            int numSkipped = 0;
+            uint termination = rayReachedMaxSteps;
 
             for (int i = 1; i <= maxSteps; i++) {
                 float tStep = stepSize * i + tNear;
-                if (tStep >= tFar) break;
+                if (tStep >= tFar) {
+                    termination = rayLeftVolume;
+                    break;
+                }
 
                 vec3 samplePos = tStep * ray.d + ray.o;
-                intensity += texture(volumeTex, mapTexCoords(samplePos)).x * scale;
+                intensity += sampleVolume(samplePos) * scale;
+                numTaken++;
+
+                // Zero everywhere in the brick adds nothing.
+                vec2 range = brickRange(samplePos);
+                if (useSkipping && range.x >= 0.0 && range.y <= 0.0) {
+                    skipBrick(ray, samplePos, tNear, 0.0, i, numSkipped);
+                }
             }
+            addSampleCounts(numTaken, numSkipped);
+            recordRayCost(numTaken, termination);
             color = vec4(intensity, intensity, intensity, 1.0);
             break;
         }
@@ -248,15 +496,29 @@ void main() {
             //  TODO: Implement maximum intensity projection (MIP) rendering.
             // --------------------------------------------------------------------------------
             float intensity = 0.0f;
+            int numTaken = 0;
+            int numSkipped = 0;
+            uint termination = rayReachedMaxSteps;
             for (int i = 1; i <= maxSteps; i++) {
                 float tStep = stepSize * i + tNear;
-                if (tStep >= tFar) break;
+                if (tStep >= tFar) {
+                    termination = rayLeftVolume;
+                    break;
+                }
 
                 vec3 samplePos = tStep * ray.d + ray.o;
-                if (texture(volumeTex, mapTexCoords(samplePos)).x > intensity){
-                    intensity = texture(volumeTex, mapTexCoords(samplePos)).x;
+                if (sampleVolume(samplePos) > intensity){
+                    intensity = sampleVolume(samplePos);
+                }
+                numTaken++;
+
+                // The brick cannot raise the maximum.
+                if (useSkipping && brickRange(samplePos).y <= intensity) {
+                    skipBrick(ray, samplePos, tNear, 0.0, i, numSkipped);
                 }
             }
+            addSampleCounts(numTaken, numSkipped);
+            recordRayCost(numTaken, termination);
             color = vec4(intensity, intensity, intensity, 1.0);
             break;
         }
@@ -266,24 +528,41 @@ void main() {
             // --------------------------------------------------------------------------------
             float sampleLastValue = 0.0f;
             vec3 sampleLastPos = ray.o;
+            int numTaken = 0;
+            int numSkipped = 0;
+            uint termination = rayReachedMaxSteps;
 
             for (int i = 1; i <= maxSteps; i++) {
                 float tStep = stepSize * i + tNear;
-                if (tStep >= tFar) break;
+                if (tStep >= tFar) {
+                    termination = rayLeftVolume;
+                    break;
+                }
 
                 vec3 samplePos = tStep * ray.d + ray.o;
                 
-                float sampleValue = texture(volumeTex, mapTexCoords(samplePos)).x;
+                float sampleValue = sampleVolume(samplePos);
+                numTaken++;
                 if ((sampleLastValue - isovalue)*(sampleValue - isovalue) < 0) {
                     // Calculate the position and the normal of isovalue, and use Blinn-Phong shading
                     vec3 iosvaluePos = mix(sampleLastPos, samplePos, (isovalue - sampleLastValue) / (sampleValue - sampleLastValue));
                     vec3 normal = calcNormal(iosvaluePos);
                     if(color != vec4(1.0, 1.0, 0.0, 1.0)) color = vec4(blinnPhong(-normal, ray.o, -ray.d), 1.0);
+                    termination = rayHitSurface;
                     break;
                 }
                 sampleLastValue = sampleValue;
                 sampleLastPos = samplePos;
+
+                // All samples inside the brick are on the same side of the iso value, so it cannot be crossed before
+                // the last one.
+                vec2 range = brickRange(samplePos);
+                if (useSkipping && (range.x > isovalue || range.y < isovalue)) {
+                    skipBrick(ray, samplePos, tNear, 0.0, i, numSkipped);
+                }
             }
+            addSampleCounts(numTaken, numSkipped);
+            recordRayCost(numTaken, termination);
             // Discard the fragment if it's not on the edge and not an isovalue (volume is transparent)
             if(!isFrontFaceEdge && !isBackFaceEdge && (color == vec4(0.0, 0.0, 0.0, 1.0))) discard;
             break;
@@ -295,6 +574,14 @@ void main() {
             vec4 outColor = vec4(0.0,0.0,0.0,0.0);
             vec3 Ca;
             float aa;
+            int numTaken = 0;
+            int numSkipped = 0;
+            uint termination = rayReachedMaxSteps;
+            // Segments are as opaque as stepSize / preIntegrationStep samples, so the image keeps its brightness
+            // with larger steps.
+            float segmentWeight = usePreIntegration ? stepSize / preIntegrationStep : 1.0;
+            float lastIntensity = 0.0;
+            bool hasLast = false;
             for (int i = 1; i <= maxSteps; i++) {
                 float tStep;
                 if (useRandom){
@@ -302,19 +589,42 @@ void main() {
                 }else{
                     tStep = stepSize * i + tNear;
                 }
-                if (tStep >= tFar) break;
+                if (tStep >= tFar) {
+                    termination = rayLeftVolume;
+                    break;
+                }
                 vec3 samplePos = tStep * ray.d + ray.o;
-                float intensity = texture(volumeTex, mapTexCoords(samplePos)).x;
-                vec4 rgba = texture(transferTex, intensity);
-
-                vec3 Cb = intensity*rgba.rgb  * scale;
-                float ab = rgba.a * scale;
+                float intensity = sampleVolume(samplePos);
+                vec3 Cb;
+                float ab;
+                if (usePreIntegration) {
+                    // The first sample is a segment of constant value.
+                    float front = hasLast ? lastIntensity : intensity;
+                    vec4 segment = texture(preIntegratedTex, vec2(intensity, front));
+                    Cb = segment.rgb * scale;
+                    ab = segment.a * scale;
+                    lastIntensity = intensity;
+                    hasLast = true;
+                } else {
+                    vec4 rgba = texture(transferTex, intensity);
+                    Cb = intensity*rgba.rgb  * scale;
+                    ab = rgba.a * scale;
+                }
 
-                outColor += vec4(Ca*aa + Cb*ab*(1-aa), aa + ab*(1-aa));
+                outColor += segmentWeight * vec4(Ca*aa + Cb*ab*(1-aa), aa + ab*(1-aa));
 
                 Ca = Cb;
                 aa = ab;
+                numTaken++;
+
+                // Fully transparent samples add nothing once the previous sample is transparent as well. Segments
+                // between two samples of the brick stay within its value range, so they are transparent, too.
+                if (useSkipping && isTransparent(brickRange(samplePos))) {
+                    skipBrick(ray, samplePos, tNear, useRandom ? offset : 0.0, i, numSkipped);
+                }
             }
+            addSampleCounts(numTaken, numSkipped);
+            recordRayCost(numTaken, termination);
             color = outColor;
             break;
         }
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "plugins/PCVC/VolumeVis/BrickedVolume.h"
+#include "plugins/PCVC/VolumeVis/VolumeFile.h"
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+static void printUsage() {
+    std::cerr << "Usage: bvolconvert <input.dat> <output.bvol> [--brick-size N] [--threads N]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path input;
+    std::filesystem::path output;
+    unsigned int brickSize = BrickedVolume::defaultBrickSize;
+    unsigned int numThreads = 0;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg(argv[i]);
+            if (arg == "--brick-size" && i + 1 < argc) {
+                brickSize = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } else if (arg == "--threads" && i + 1 < argc) {
+                numThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } else if (input.empty()) {
+                input = arg;
+            } else if (output.empty()) {
+                output = arg;
+            } else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    if (input.empty() || output.empty() || brickSize == 0) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const VolumeFile volume = VolumeFile::read(input);
+        const std::size_t rawSize =
+            static_cast<std::size_t>(volume.res.x) * volume.res.y * volume.res.z * voxelSize(volume.type);
+
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t fileSize =
+            BrickedVolume::write(output, volume.type, volume.res, volume.voxels, brickSize, numThreads);
+        const auto compressed = std::chrono::steady_clock::now();
+        const BrickedVolume bricked(output);
+        const auto decoded = bricked.decodeAll(numThreads);
+        const auto end = std::chrono::steady_clock::now();
+
+        using ms = std::chrono::duration<double, std::milli>;
+        std::cout << "Volume:     " << volume.res.x << " x " << volume.res.y << " x " << volume.res.z << ", "
+                  << rawSize << " bytes" << std::endl;
+        std::cout << "Levels:     " << bricked.numLevels() << std::endl;
+        std::cout << "Bricked:    " << fileSize << " bytes, ratio "
+                  << static_cast<double>(rawSize) / static_cast<double>(fileSize) << std::endl;
+        std::cout << "Compress:   " << ms(compressed - start).count() << " ms" << std::endl;
+        std::cout << "Decompress: " << ms(end - compressed).count() << " ms" << std::endl;
+        if (decoded->size() != rawSize || std::memcmp(decoded->data(), volume.voxels, rawSize) != 0) {
+            std::cerr << "Decoded volume does not match the input!" << std::endl;
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
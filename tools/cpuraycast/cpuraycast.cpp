@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "plugins/PCVC/VolumeVis/CpuRaycaster.h"
+#include "plugins/PCVC/VolumeVis/Histogram.h"
+#include "plugins/PCVC/VolumeVis/TransferFunction.h"
+#include "plugins/PCVC/VolumeVis/VolumeFile.h"
+
+using namespace OGL4Core2::Plugins::PCVC::VolumeVis;
+
+// Number of transfer function entries of the VolumeVis editor.
+static constexpr std::size_t numTfEntries = 256;
+
+static void printUsage() {
+    std::cerr << "Usage: cpuraycast <input.dat|input.bvol> <output.png> [--params file] [--tf file] [--threads N]"
+              << std::endl;
+}
+
+/**
+ * Defaults of the VolumeVis GUI, with the camera at its initial position.
+ */
+static CpuRaycaster::Parameters defaultParameters() {
+    CpuRaycaster::Parameters params{};
+    params.width = 800;
+    params.height = 600;
+    // The orbit camera of VolumeVis starts at a distance of 2 with a vertical field of view of 45 degrees.
+    CpuRaycaster::setCamera(params, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f)), 45.0f);
+    params.viewMode = 0;
+    params.showBox = true;
+    params.useRandom = true;
+    params.maxSteps = 600;
+    params.stepSize = 0.001f;
+    params.scale = 0.02f;
+    params.isoValue = 0.5f;
+    params.ambient = glm::vec3(1.0f);
+    params.diffuse = glm::vec3(1.0f);
+    params.specular = glm::vec3(1.0f);
+    params.kAmb = 0.2f;
+    params.kDiff = 0.7f;
+    params.kSpec = 0.1f;
+    params.kExp = 120.0f;
+    params.backgroundColor = glm::vec3(0.2f);
+    params.preIntegration = false;
+    params.preIntegrationStep = 0.001f;
+    return params;
+}
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path input;
+    std::filesystem::path output;
+    std::filesystem::path paramsFile;
+    std::filesystem::path tfFile;
+    unsigned int numThreads = 0;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg(argv[i]);
+            if (arg == "--params" && i + 1 < argc) {
+                paramsFile = argv[++i];
+            } else if (arg == "--tf" && i + 1 < argc) {
+                tfFile = argv[++i];
+            } else if (arg == "--threads" && i + 1 < argc) {
+                numThreads = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } else if (input.empty()) {
+                input = arg;
+            } else if (output.empty()) {
+                output = arg;
+            } else {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    if (input.empty() || output.empty()) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        CpuRaycaster::Parameters params = defaultParameters();
+        if (!paramsFile.empty()) {
+            CpuRaycaster::readParameters(paramsFile, params);
+        }
+
+        // The transfer function is only used in volume mode, a linear ramp stands in if none is given.
+        std::vector<float> transferFunction(4 * numTfEntries);
+        if (!tfFile.empty()) {
+            transferFunction = TransferFunction::resample(TransferFunction::read(tfFile), numTfEntries);
+        } else {
+            for (std::size_t i = 0; i < transferFunction.size(); i++) {
+                transferFunction[i] = static_cast<float>(i / 4) / static_cast<float>(numTfEntries - 1);
+            }
+        }
+
+        const VolumeFile volume = VolumeFile::read(input);
+        const std::size_t numVoxels = static_cast<std::size_t>(volume.res.x) * volume.res.y * volume.res.z;
+
+        // Value mapping and dimensions like VolumeVis: 8 bit volumes use the full range of the type, other types
+        // their actual values, the largest dimension is 1.
+        const auto [range, textureMax] = dispatchVoxelType(volume.type, [&](auto traits) {
+            using T = typename decltype(traits)::Scalar;
+            Histogram::ValueRange valueRange{0.0f, 255.0f};
+            if constexpr (!std::is_same_v<T, std::uint8_t>) {
+                valueRange = Histogram::valueRange(static_cast<const T*>(volume.voxels), numVoxels, numThreads);
+            }
+            return std::make_pair(valueRange, traits.textureMax);
+        });
+        const float rangeExtent = range.max > range.min ? range.max - range.min : 1.0f;
+        params.valueScale = textureMax / rangeExtent;
+        params.valueOffset = -range.min / rangeExtent;
+        const auto maxRes = static_cast<float>(std::max({volume.res.x, volume.res.y, volume.res.z}));
+        params.volumeDim = glm::vec3(volume.res) / maxRes;
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto image =
+            CpuRaycaster::render({volume.type, volume.voxels, volume.res}, transferFunction, params, numThreads);
+        const auto end = std::chrono::steady_clock::now();
+        CpuRaycaster::writeImage(output, image, params.width, params.height);
+
+        using ms = std::chrono::duration<double, std::milli>;
+        std::cout << "Volume: " << volume.res.x << " x " << volume.res.y << " x " << volume.res.z << std::endl;
+        std::cout << "Image:  " << params.width << " x " << params.height << ", " << ms(end - start).count()
+                  << " ms" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}